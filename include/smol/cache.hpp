@@ -0,0 +1,99 @@
+#pragma once
+
+#include <smol/memory.hpp>
+#include <smol/types.hpp>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class ReplacementPolicy
+{
+	Lru,
+	Fifo,
+	Random
+};
+
+struct CacheConfig
+{
+	std::size_t       size          = 8 * 1024;
+	std::size_t       associativity = 2;
+	std::size_t       line_size     = 32;
+	ReplacementPolicy replacement   = ReplacementPolicy::Lru;
+};
+
+/// Parses a comma-separated cache specification, e.g. `size=8k,ways=2,line=32,policy=lru`.
+/// Omitted keys keep their default value. Throws `std::runtime_error` on invalid input.
+auto parse_cache_config(std::string_view spec) -> CacheConfig;
+
+struct CacheCounters
+{
+	std::uint64_t hits   = 0;
+	std::uint64_t misses = 0;
+
+	[[nodiscard]] auto accesses() const -> std::uint64_t { return hits + misses; }
+	[[nodiscard]] auto miss_rate() const -> double;
+};
+
+/// Set-associative, write-back, write-allocate cache model. Only tags are tracked, not data.
+struct Cache
+{
+	explicit Cache(CacheConfig config);
+
+	/// Looks up the line holding `addr`, filling it on a miss. Returns whether the access hit.
+	auto access(Addr addr, bool write) -> bool;
+
+	[[nodiscard]] auto config() const -> const CacheConfig& { return m_config; }
+	[[nodiscard]] auto counters() const -> const CacheCounters& { return m_counters; }
+	[[nodiscard]] auto writebacks() const -> std::uint64_t { return m_writebacks; }
+
+	[[nodiscard]] auto describe() const -> std::string;
+
+	private:
+	struct Line
+	{
+		Addr          tag   = 0;
+		bool          valid = false;
+		bool          dirty = false;
+		std::uint64_t stamp = 0; ///< Last use for LRU, fill time for FIFO
+	};
+
+	auto victim(std::size_t set) -> Line&;
+
+	CacheConfig       m_config;
+	std::vector<Line> m_lines;
+	std::size_t       m_sets;
+	unsigned          m_line_shift;
+
+	CacheCounters m_counters;
+	std::uint64_t m_writebacks = 0;
+	std::uint64_t m_clock      = 0;
+	std::uint32_t m_rng        = 0x2545'F491;
+};
+
+/// Feeds `Mmu` accesses to separate instruction and data caches, and breaks hit/miss counts down per code region,
+/// i.e. per `region_size` bytes block of `rip`. MMIO accesses are uncached and ignored.
+struct CacheSimulator
+{
+	struct RegionCounters
+	{
+		CacheCounters fetch;
+		CacheCounters data;
+	};
+
+	std::optional<Cache> icache;
+	std::optional<Cache> dcache;
+	std::size_t          region_size = 256;
+
+	std::map<Addr, RegionCounters> regions;
+
+	/// Accesses every line that `granularity` bytes at `addr` overlap, e.g. both lines of a 32-bit instruction
+	/// crossing a line boundary.
+	void access(Addr addr, AccessGranularity granularity, AccessKind kind, Addr rip);
+
+	/// Reports totals, then the `max_regions` regions with the most misses.
+	[[nodiscard]] auto report(std::size_t max_regions = 16) const -> std::string;
+};
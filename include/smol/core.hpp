@@ -1,12 +1,21 @@
 #pragma once
 
+#include <smol/instruction.hpp>
 #include <smol/memory.hpp>
 #include <smol/registers.hpp>
+#include <smol/stats.hpp>
 
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <limits>
 #include <optional>
 #include <string>
+#include <string_view>
+
+struct Coverage;
+struct Profiler;
+struct TimingModel;
 
 struct RegisterFile
 {
@@ -18,14 +27,53 @@ struct RegisterFile
 	auto operator[](RegisterId id) const -> const Word& { return data.at(std::size_t(id)); }
 };
 
+/// Limits for `Core::run`; unset limits are unbounded.
+struct RunLimits
+{
+	std::optional<std::uint64_t>                 max_instructions;
+	std::optional<std::chrono::duration<double>> max_time;
+
+	/// Print the average emulation speed every 10M instructions
+	bool report_speed = false;
+};
+
+enum class StopReason
+{
+	Halted,
+	InstructionLimit,
+	TimeLimit,
+	Stopped,
+	Count
+};
+
+static constexpr std::array<std::string_view, std::size_t(StopReason::Count)> stop_reason_names = {
+	"halted", "instruction limit", "time limit", "stopped"};
+
 struct InterruptState
 {
 	bool enabled = false;
 	Word intret = 0;
+
+	/// Set while spinning on `intwait`, so that the interrupt returns past it
+	bool waiting = false;
+};
+
+/// Reservation taken by `ll32` for the next `sc32`, see `doc/memory-model.md`.
+struct Reservation
+{
+	Addr addr  = 0;
+	u32  value = 0;
 };
 
 struct Core
 {
+	static constexpr std::uint64_t slice_length = 10000;
+
+	static constexpr std::size_t interrupt_count = 16;
+
+	/// Interrupt 0, raised by exceptions. It cannot be masked.
+	static constexpr Word exception_interrupt = 0;
+
 	RegisterFile       regs;
 	std::optional<u32> current_instruction;
 	u32                rip = 0;
@@ -37,17 +85,96 @@ struct Core
 
 	std::size_t executed_ops = 0;
 
+	std::optional<Reservation> reservation;
+
+	/// Set by `halt`, possibly from another thread; stops `run` after the current instruction.
+	std::atomic<bool> halted      = false;
+	Word              exit_status = 0;
+
+	/// Bitmask of interrupt IDs raised by `raise_interrupt` and not yet fired.
+	std::atomic<u32> pending_interrupts = 0;
+
+	/// Bitmask of interrupt IDs allowed to fire while pending. The exception interrupt is always allowed.
+	std::atomic<u32> interrupt_mask = (u32(1) << interrupt_count) - 1;
+
+	/// Optional cycle estimate model, fed with every executed instruction when set.
+	TimingModel* timing = nullptr;
+
+	/// Optional sampling profiler, fed with every executed instruction when set.
+	Profiler* profiler = nullptr;
+
+	/// Optional bitmap of executed instruction addresses, marked for every executed instruction when set.
+	Coverage* coverage = nullptr;
+
+#ifdef SMOLISA_STATS
+	ExecutionStats stats;
+#endif
+
 	using Timer = std::chrono::high_resolution_clock;
 	Timer::time_point start_time;
 
 	std::function<void(Core&)> panic_handler;
+
+	/// Called when executing `brk`. Returning `true` stops on it: `rip` is left pointing to the `brk`.
+	/// Returning `false` continues past it. When empty, `brk` only prints its address.
+	std::function<bool(Core&)> breakpoint_handler;
 	std::function<void()> keepalive;
 
+	/// Called by `run` before each instruction when set, e.g. for debugger breakpoints. Returning `true` stops `run`
+	/// before the instruction with `StopReason::Stopped`. Only considered at the start of a slice, so that runs without
+	/// it do not check it for every instruction.
+	std::function<bool(Core&)> instruction_hook;
+
+	/// Called by `run` at the end of every slice, for devices to catch up with executed instructions and host time,
+	/// e.g. to raise timer interrupts, and to request their next deadline.
+	std::function<void()> sync_devices;
+
 	auto fetch_instruction_u32() -> std::optional<u32>;
 
+	/// Executes an already fetched and decoded instruction at `rip`.
+	void execute(const insns::AnyInstruction& decoded_ins);
+
 	void execute_single();
-	void boot();
 
+	/// Runs until halted or until a limit is reached. Limits and `keepalive` are checked every `slice_length`
+	/// instructions.
+	auto run(const RunLimits& limits = {}) -> StopReason;
+
+	/// Prints the initial state, then runs while reporting emulation speed.
+	auto boot(RunLimits limits = {}) -> StopReason;
+
+	/// Stops execution after the current instruction, e.g. on a guest request to exit. Thread-safe; only the first
+	/// call sets `exit_status`.
+	void halt(Word status);
+
+	/// Stops `run` after the current instruction with `StopReason::Stopped`, e.g. from `breakpoint_handler`. Unlike
+	/// `halt`, the core can run again. Only callable from the thread running the core, and ignored outside of `run`.
+	void stop();
+
+	/// Ends the current slice of `run` once `executed_ops` reaches `at`, so that `sync_devices` runs on time. Requests
+	/// only hold until the next `sync_devices` call.
+	void request_deadline(std::uint64_t at);
+
+	/// Instruction count at which the current slice has to end, as requested through `request_deadline`.
+	[[nodiscard]] auto deadline() const -> std::uint64_t { return m_deadline; }
+
+	/// Clears deadlines, then calls `sync_devices`. Called by `run` at the end of every slice, and by other loops
+	/// driving the core.
+	void end_slice();
+
+	/// Marks interrupt `id` as pending. Thread-safe, e.g. for devices and inter-processor interrupts.
+	///
+	/// Pending interrupts are only considered between two slices of `run`, and on `inton`, `intret` and `intwait`,
+	/// so that nothing has to be checked for every instruction. Among those that are not masked, the lowest ID fires
+	/// first.
+	void raise_interrupt(Word id);
+
+	/// Fires the highest priority pending interrupt that is not masked, if interrupts are enabled. Returns whether
+	/// it did.
+	auto deliver_interrupts() -> bool;
+
+	/// Fires interrupt `id` right away if interrupts are enabled, and otherwise leaves it pending until they are.
+	/// Returns whether it fired.
 	auto fire_interrupt(Word id) -> bool;
 	void fire_exception(std::string_view reason = "");
 	auto check_access_else_fault(AccessStatus status) -> bool;
@@ -55,4 +182,9 @@ struct Core
 	[[nodiscard]] auto debug_state_multiline() const -> std::string;
 	[[nodiscard]] auto debug_state() const -> std::string;
 	[[nodiscard]] auto debug_state_preamble() const -> std::string;
+
+	private:
+	std::uint64_t m_slice_end      = 0;
+	std::uint64_t m_deadline       = std::numeric_limits<std::uint64_t>::max();
+	bool          m_stop_requested = false;
 };
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <smol/symbols.hpp>
+#include <smol/types.hpp>
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Bitmap of executed instruction addresses over `[0; code_size)`, one bit per 16-bit aligned address.
+///
+/// Saved bitmaps are OR-merged, so one file can accumulate coverage across several runs of the same ROM. Files hold a
+/// hash of the ROM, so that coverage of different ROMs is never merged.
+struct Coverage
+{
+	static constexpr std::string_view file_magic = "SMOLCOV2";
+
+	std::size_t                code_size;
+	std::uint64_t              rom_hash;
+	std::vector<std::uint64_t> bits;
+
+	/// Covers `code`, the ROM as loaded at address 0.
+	explicit Coverage(std::span<const u8> code);
+
+	void mark(Addr rip)
+	{
+		const std::size_t index = rip >> 1;
+
+		if (index < m_address_count) [[likely]]
+		{
+			bits[index / 64] |= std::uint64_t(1) << (index % 64);
+		}
+	}
+
+	[[nodiscard]] auto is_covered(Addr rip) const -> bool
+	{
+		const std::size_t index = rip >> 1;
+		return index < m_address_count && ((bits[index / 64] >> (index % 64)) & 1) != 0;
+	}
+
+	/// Throws `std::runtime_error` if `other` covers a different ROM.
+	void merge(const Coverage& other);
+
+	/// Throws `std::runtime_error` if the file cannot be read or is not a coverage file.
+	static auto load(std::string_view path) -> Coverage;
+
+	/// Merges with the coverage already stored at `path`, if any, and writes the result back. Throws
+	/// `std::runtime_error` on failure, or if `path` holds coverage of a different ROM, leaving it as is.
+	void save_merged(std::string_view path) const;
+
+	/// Per-label count of executed instruction addresses, listing labels that were never reached first.
+	[[nodiscard]] auto report(const SymbolMap& symbols) const -> std::string;
+
+	private:
+	Coverage(std::size_t code_size, std::uint64_t rom_hash);
+
+	std::size_t m_address_count;
+};
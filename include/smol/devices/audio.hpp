@@ -0,0 +1,109 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/mmio.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/types.hpp>
+#include <smol/wav.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+/// PCM audio output, playing samples from a ring buffer in guest RAM at a fixed sample rate.
+///
+/// The guest stores samples into the ring with plain stores and only goes through MMIO to publish its write offset, so
+/// that samples are transferred to the host in bulk. The host consumes them in host time, between slices. Running out
+/// of samples plays silence.
+///
+/// Registers (all u32):
+/// - `+0x00` (read/write): control; bit 0 enables playback, bit 1 selects 16-bit signed rather than 8-bit unsigned
+///   samples, bit 2 selects interleaved stereo rather than mono. Enabling resets the read and write offsets
+/// - `+0x04` (read/write): sample rate, in frames per second
+/// - `+0x08` (read/write): ring buffer address in RAM
+/// - `+0x0C` (read/write): ring buffer size in bytes, a multiple of the frame size
+/// - `+0x10` (read/write): write offset, just past the last byte written by the guest
+/// - `+0x14` (read): read offset, of the next byte to be played
+/// - `+0x18` (read/write): watermark; `interrupt_id` is raised when fewer bytes than this are queued
+/// - `+0x1C` (read): status; bit 0 is set while below the watermark, bit 1 once silence was played for lack of
+///   samples. Writing 1s clears bit 1
+struct AudioDevice
+{
+	static constexpr Addr mmio_address = 0x6000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr control_register     = 0x00;
+	static constexpr Addr sample_rate_register = 0x04;
+	static constexpr Addr address_register     = 0x08;
+	static constexpr Addr size_register        = 0x0C;
+	static constexpr Addr write_register       = 0x10;
+	static constexpr Addr read_register        = 0x14;
+	static constexpr Addr watermark_register   = 0x18;
+	static constexpr Addr status_register      = 0x1C;
+
+	static constexpr u32 control_enable = 1 << 0;
+	static constexpr u32 control_16bit  = 1 << 1;
+	static constexpr u32 control_stereo = 1 << 2;
+
+	static constexpr u32 status_low      = 1 << 0;
+	static constexpr u32 status_underrun = 1 << 1;
+
+	static constexpr Word interrupt_id = 0xD;
+
+	using Clock = std::chrono::steady_clock;
+
+	/// Called when the queued samples drop below the watermark.
+	std::function<void()> on_interrupt;
+
+	/// Called with every played block of frames, silence included.
+	std::function<void(const AudioFormat&, std::span<const u8>)> on_samples;
+
+	explicit AudioDevice(Core& core) : m_core(core) {}
+
+	void attach(MmioBus& bus);
+
+	/// Plays the frames due since the last call.
+	void sync();
+
+	[[nodiscard]] auto format() const -> AudioFormat;
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+
+	/// Saves the registers for a snapshot. Playback resumes from the saved read offset.
+	void save_state(StateWriter& w) const;
+
+	/// Restores what `save_state` saved. RAM must already be restored. Throws `std::runtime_error` when playback is
+	/// enabled with a ring that `write` would have rejected, leaving the device unchanged.
+	void load_state(StateReader& r);
+
+	private:
+	[[nodiscard]] static auto format_for(u32 control, u32 sample_rate) -> AudioFormat;
+	[[nodiscard]] auto enabled() const -> bool { return (m_control & control_enable) != 0; }
+	[[nodiscard]] auto queued() const -> u32;
+
+	/// Whether a ring of `size` bytes at `address` holds whole frames of `control`'s format, and fits in RAM.
+	[[nodiscard]] auto valid_ring(u32 control, u32 sample_rate, u32 address, u32 size) const -> bool;
+
+	/// Updates the watermark status, raising the interrupt when crossing below it.
+	void check_watermark();
+
+	Core& m_core;
+
+	u32 m_control     = 0;
+	u32 m_sample_rate = 44100;
+	u32 m_address     = 0;
+	u32 m_size        = 0;
+	u32 m_write       = 0;
+	u32 m_read        = 0;
+	u32 m_watermark   = 0;
+	u32 m_status      = 0;
+
+	/// Frames played since playback was enabled at `m_epoch`
+	std::uint64_t     m_played = 0;
+	Clock::time_point m_epoch;
+
+	std::vector<u8> m_block;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/mmio.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/types.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/// Disk image file mapped into host memory. Writes through the mapping reach the file.
+struct DiskImage
+{
+	std::string path;
+	bool        read_only = false;
+
+	/// Maps `path` read-write, or read-only if it cannot be opened for writing. Throws `std::runtime_error` if it cannot
+	/// be opened at all.
+	explicit DiskImage(std::string_view path);
+	~DiskImage();
+
+	DiskImage(const DiskImage&)                    = delete;
+	auto operator=(const DiskImage&) -> DiskImage& = delete;
+
+	[[nodiscard]] auto size() const -> std::size_t { return m_size; }
+	[[nodiscard]] auto data() -> u8* { return m_data; }
+
+	/// Writes modified pages back to the file.
+	void flush();
+
+	private:
+	u8*         m_data = nullptr;
+	std::size_t m_size = 0;
+};
+
+/// Block storage, transferring whole sectors between a disk image and guest RAM on a host worker thread.
+///
+/// The guest sets up a transfer and issues a command, then gets `interrupt_id` once the transfer completed. RAM covered
+/// by a transfer must not be accessed until it completes.
+///
+/// Registers (all u32):
+/// - `+0x00` (read/write): first sector of the transfer
+/// - `+0x04` (read/write): RAM address of the transfer
+/// - `+0x08` (read/write): number of sectors to transfer
+/// - `+0x0C` (write): command; 1 reads sectors into RAM, 2 writes sectors from RAM, 3 flushes writes to the image file
+/// - `+0x10` (read): status; bit 0 is set while busy, bit 1 on completion, bit 2 on error. Writing 1s clears bits 1 and 2
+/// - `+0x14` (read): number of sectors of the disk
+struct BlockDevice
+{
+	static constexpr Addr mmio_address = 0x7000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr sector_register  = 0x00;
+	static constexpr Addr address_register = 0x04;
+	static constexpr Addr count_register   = 0x08;
+	static constexpr Addr command_register = 0x0C;
+	static constexpr Addr status_register  = 0x10;
+	static constexpr Addr sectors_register = 0x14;
+
+	static constexpr u32 command_read  = 1;
+	static constexpr u32 command_write = 2;
+	static constexpr u32 command_flush = 3;
+
+	static constexpr u32 status_busy  = 1 << 0;
+	static constexpr u32 status_done  = 1 << 1;
+	static constexpr u32 status_error = 1 << 2;
+
+	static constexpr std::size_t sector_size = 512;
+
+	static constexpr Word interrupt_id = 0xB;
+
+	/// Called from the worker thread when a command completes.
+	std::function<void()> on_interrupt;
+
+	/// Without an image, the disk has no sectors and every transfer fails.
+	BlockDevice(Core& core, std::unique_ptr<DiskImage> image);
+
+	/// Waits for the current command, then joins the worker.
+	~BlockDevice();
+
+	BlockDevice(const BlockDevice&)                    = delete;
+	auto operator=(const BlockDevice&) -> BlockDevice& = delete;
+
+	void attach(MmioBus& bus);
+
+	[[nodiscard]] auto sector_count() const -> u32 { return m_image ? u32(m_image->size() / sector_size) : 0; }
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+
+	/// Waits for the current command, then saves the registers for a snapshot. The disk image is not saved.
+	void save_state(StateWriter& w);
+	void load_state(StateReader& r);
+
+	private:
+	struct Command
+	{
+		u32 kind;
+		u32 sector;
+		u32 address;
+		u32 count;
+	};
+
+	void work();
+
+	/// Performs `command`, returning false if it is invalid.
+	auto execute(const Command& command) -> bool;
+
+	Core&                      m_core;
+	std::unique_ptr<DiskImage> m_image;
+
+	u32 m_sector  = 0;
+	u32 m_address = 0;
+	u32 m_count   = 0;
+
+	std::atomic<u32> m_status{0};
+
+	std::mutex              m_mutex;
+	std::condition_variable m_wake;
+	std::optional<Command>  m_pending;
+	bool                    m_stopping = false;
+
+	std::thread m_worker;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/mmio.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/types.hpp>
+
+#include <functional>
+
+/// DMA engine, copying and filling memory at host speed on behalf of the guest.
+///
+/// Transfers complete within the write starting them. RAM is accessed in bulk, bypassing watchpoints and access hooks;
+/// MMIO is accessed byte by byte through the bus, so that e.g. the framebuffer can be a destination.
+///
+/// Registers (all u32):
+/// - `+0x00` (read/write): source address
+/// - `+0x04` (read/write): destination address
+/// - `+0x08` (read/write): length in bytes, or number of blocks in stride mode
+/// - `+0x0C` (read/write): control; writing starts a transfer. Bits 0..1 select the mode: 0 copies, 1 fills the
+///   destination with the low byte of the fill value, 2 copies blocks between strided addresses. Bit 8 raises
+///   `interrupt_id` on completion
+/// - `+0x10` (read/write): fill value
+/// - `+0x14` (read/write): block size in bytes, for stride mode
+/// - `+0x18` (read/write): source stride in bytes, for stride mode
+/// - `+0x1C` (read/write): destination stride in bytes, for stride mode
+/// - `+0x20` (read): status; bit 0 is set on completion, bit 1 on error. Writing 1s clears the matching bits
+struct DmaController
+{
+	static constexpr Addr mmio_address = 0x8000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr source_register             = 0x00;
+	static constexpr Addr destination_register        = 0x04;
+	static constexpr Addr length_register             = 0x08;
+	static constexpr Addr control_register            = 0x0C;
+	static constexpr Addr fill_register               = 0x10;
+	static constexpr Addr block_size_register         = 0x14;
+	static constexpr Addr source_stride_register      = 0x18;
+	static constexpr Addr destination_stride_register = 0x1C;
+	static constexpr Addr status_register             = 0x20;
+
+	static constexpr u32 mode_mask   = 0b11;
+	static constexpr u32 mode_copy   = 0;
+	static constexpr u32 mode_fill   = 1;
+	static constexpr u32 mode_stride = 2;
+
+	static constexpr u32 control_interrupt = 1 << 8;
+
+	static constexpr u32 status_done  = 1 << 0;
+	static constexpr u32 status_error = 1 << 1;
+
+	static constexpr Word interrupt_id = 0xA;
+
+	/// Called on completion of transfers that requested it.
+	std::function<void()> on_interrupt;
+
+	explicit DmaController(Core& core) : m_core(core) {}
+
+	/// Maps the registers, and routes MMIO transfers through `bus`.
+	void attach(MmioBus& bus);
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+
+	/// Saves the registers for a snapshot. Transfers complete within register writes, so none can be in flight.
+	void save_state(StateWriter& w) const;
+	void load_state(StateReader& r);
+
+	private:
+	/// Runs the transfer described by the registers, returning false if any part of it is invalid.
+	auto transfer() -> bool;
+
+	/// Whether `[addr; addr + length)` lies entirely within RAM, or entirely within MMIO outside of this device.
+	[[nodiscard]] auto is_valid_range(Addr addr, std::uint64_t length) const -> bool;
+
+	auto copy(Addr source, Addr destination, u32 length) -> bool;
+	auto fill(Addr destination, u32 length, u8 value) -> bool;
+
+	auto load_u8(Addr addr) -> std::pair<AccessStatus, u8>;
+	auto store_u8(Addr addr, u8 value) -> AccessStatus;
+
+	Core&    m_core;
+	MmioBus* m_bus = nullptr;
+
+	u32 m_source             = 0;
+	u32 m_destination        = 0;
+	u32 m_length             = 0;
+	u32 m_control            = 0;
+	u32 m_fill               = 0;
+	u32 m_block_size         = 0;
+	u32 m_source_stride      = 0;
+	u32 m_destination_stride = 0;
+	u32 m_status             = 0;
+};
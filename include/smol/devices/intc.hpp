@@ -0,0 +1,37 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/mmio.hpp>
+#include <smol/types.hpp>
+
+/// Interrupt controller, through which devices raise interrupts on a core and the guest masks them.
+///
+/// Interrupts stay pending until they fire, so devices raise them once rather than retrying. Lower IDs take priority.
+///
+/// Registers:
+/// - `+0x0` (u32, read): pending interrupts bitmask
+/// - `+0x0` (u32, write): clears the pending interrupts whose bits are set
+/// - `+0x4` (u32, read/write): mask of interrupts allowed to fire, all of them on reset
+/// - `+0x8` (u32, write): raises the interrupt with the written ID
+struct InterruptController
+{
+	static constexpr Addr mmio_address = 0x4000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr pending_register = 0x0;
+	static constexpr Addr mask_register    = 0x4;
+	static constexpr Addr raise_register   = 0x8;
+
+	/// Core receiving device interrupts
+	Core& core;
+
+	explicit InterruptController(Core& core) : core(core) {}
+
+	/// Marks interrupt `id` as pending. Thread-safe.
+	void raise(Word id) { core.raise_interrupt(id); }
+
+	void attach(MmioBus& bus);
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <smol/mmio.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/spsc.hpp>
+#include <smol/types.hpp>
+
+#include <atomic>
+#include <functional>
+
+/// Keyboard, queueing character events from a single host input source for the guest to read.
+///
+/// The host side may push from any one thread, e.g. the framebuffer window or an `InputReader`, without ever blocking on
+/// the guest. The interrupt is raised as the event is queued, so that the guest sees it at the next interrupt check
+/// rather than at the next presented frame.
+///
+/// Registers (all u32):
+/// - `+0x0` (read): number of queued events
+/// - `+0x4` (read): pops the oldest event, or reads 0 if there is none. Bits 0..7 hold the character, bit 8 is always set
+/// - `+0x8` (read/write): control; bit 0 raises `interrupt_id` whenever an event is queued
+/// - `+0xC` (read): events dropped because the queue was full. Any write resets it
+struct Keyboard
+{
+	static constexpr Addr mmio_address = 0x0000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr count_register   = 0x0;
+	static constexpr Addr data_register    = 0x4;
+	static constexpr Addr control_register = 0x8;
+	static constexpr Addr dropped_register = 0xC;
+
+	static constexpr u32 control_interrupt = 1 << 0;
+
+	static constexpr u32 event_valid = 1 << 8;
+
+	static constexpr Word interrupt_id = 0xE;
+
+	static constexpr std::size_t queue_size = 256;
+
+	/// Called from the producer thread when an event is queued while interrupts are enabled.
+	std::function<void()> on_interrupt;
+
+	void attach(MmioBus& bus);
+
+	/// Queues a character typed on the host. Must always be called from the same thread.
+	void push(u8 character);
+
+	auto read(Addr offset, AccessGranularity granularity) -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+
+	/// Saves the control and dropped event count for a snapshot. Queued events come from the host, and are not saved.
+	void save_state(StateWriter& w) const;
+	void load_state(StateReader& r);
+
+	private:
+	SpscRing<u8, queue_size> m_queue;
+
+	std::atomic<u32> m_control{0};
+	std::atomic<u32> m_dropped{0};
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <smol/mmio.hpp>
+#include <smol/types.hpp>
+
+#include <functional>
+
+/// Multi-core controller, letting cores interrupt each other.
+///
+/// Registers:
+/// - `+0x0` (u32, read): number of cores
+/// - `+0x4` (u32, write): raise `ipi_interrupt` on the core with the written index
+struct SmpController
+{
+	static constexpr Addr mmio_address = 0x9000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr core_count_register = 0x0;
+	static constexpr Addr ipi_register        = 0x4;
+
+	/// Interrupt ID of inter-processor interrupts
+	static constexpr Word ipi_interrupt = 0x8;
+
+	u32 core_count = 1;
+
+	/// Called with the target core index when the guest sends an inter-processor interrupt.
+	std::function<void(u32)> on_ipi;
+
+	void attach(MmioBus& bus);
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <smol/mmio.hpp>
+#include <smol/types.hpp>
+
+#include <functional>
+
+/// System controller, letting the guest end emulation and control its pacing.
+///
+/// Registers:
+/// - `+0x0` (u32, write): exit with the written value as status code
+/// - `+0x4` (u32, write): enter warp mode if non-zero, leave it if zero
+struct SystemController
+{
+	static constexpr Addr mmio_address = 0x1000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr exit_register = 0x0;
+	static constexpr Addr warp_register = 0x4;
+
+	/// Called with the status code when the guest requests to exit.
+	std::function<void(u32)> on_exit;
+
+	/// Called when the guest enters or leaves warp mode, e.g. around loading screens.
+	std::function<void(bool)> on_warp;
+
+	void attach(MmioBus& bus);
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+};
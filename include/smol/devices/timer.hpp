@@ -0,0 +1,81 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/mmio.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/types.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+/// Compare-match timer, counting either executed instructions or scaled host time.
+///
+/// Instruction counting is deterministic: the core ends its slice right at the match, so the interrupt is raised before
+/// the next instruction. Host time is checked between slices.
+///
+/// Registers (all u32):
+/// - `+0x0` (read/write): control; bit 0 enables and restarts the count, bit 1 selects periodic rather than one-shot
+///   mode, bit 2 counts host time rather than instructions
+/// - `+0x4` (read/write): compare value, in ticks since the count started
+/// - `+0x8` (read): ticks since the count started
+/// - `+0xC` (read): status; bit 0 is set on compare match. Writing 1s clears the matching bits
+struct IntervalTimer
+{
+	static constexpr Addr mmio_address = 0x3000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr control_register = 0x0;
+	static constexpr Addr compare_register = 0x4;
+	static constexpr Addr count_register   = 0x8;
+	static constexpr Addr status_register  = 0xC;
+
+	static constexpr u32 control_enable    = 1 << 0;
+	static constexpr u32 control_periodic  = 1 << 1;
+	static constexpr u32 control_host_time = 1 << 2;
+
+	static constexpr u32 status_matched = 1 << 0;
+
+	static constexpr Word interrupt_id = 0xC;
+
+	using Clock = std::chrono::steady_clock;
+
+	/// Host time ticks per microsecond, e.g. 0.5 to make host time pass at half speed for the guest
+	double time_scale = 1.0;
+
+	/// Called on every compare match.
+	std::function<void()> on_interrupt;
+
+	explicit IntervalTimer(Core& core) : m_core(core) {}
+
+	void attach(MmioBus& bus);
+
+	/// Raises the interrupt if the compare value was reached, and requests the next deadline from the core.
+	void sync();
+
+	auto read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+
+	/// Saves the registers and the count for a snapshot. Host time counts resume from where they were saved.
+	void save_state(StateWriter& w) const;
+
+	/// Restores what `save_state` saved. The core state must already be restored.
+	void load_state(StateReader& r);
+
+	private:
+	[[nodiscard]] auto ticks() const -> std::uint64_t;
+	[[nodiscard]] auto enabled() const -> bool { return (m_control & control_enable) != 0; }
+	void               schedule();
+
+	Core& m_core;
+
+	u32 m_control = 0;
+	u32 m_compare = 0;
+	u32 m_status  = 0;
+
+	/// Tick at which the count started, and count when the timer was last stopped
+	std::uint64_t m_start   = 0;
+	std::uint64_t m_stopped = 0;
+
+	Clock::time_point m_epoch = Clock::now();
+};
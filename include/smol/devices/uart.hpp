@@ -0,0 +1,80 @@
+#pragma once
+
+#include <smol/mmio.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/spsc.hpp>
+#include <smol/types.hpp>
+
+#include <atomic>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+/// Serial console. Transmitted bytes are buffered and handed to the host in batches; received bytes come from a single
+/// host producer thread, e.g. an `InputReader` on stdin.
+///
+/// Registers:
+/// - `+0x0` (u8 or u32, write): transmits the low byte
+/// - `+0x0` (u32, read): pops the oldest received byte, or reads 0 if there is none. Bit 8 is set for valid bytes
+/// - `+0x4` (u32, read): number of received bytes waiting to be read
+/// - `+0x8` (u32, read/write): control; bit 0 raises `interrupt_id` whenever a byte is received
+struct Uart
+{
+	static constexpr Addr mmio_address = 0x5000;
+	static constexpr Addr mmio_size    = 0x1000;
+
+	static constexpr Addr data_register     = 0x0;
+	static constexpr Addr rx_count_register = 0x4;
+	static constexpr Addr control_register  = 0x8;
+
+	static constexpr u32 control_interrupt = 1 << 0;
+
+	static constexpr u32 rx_valid = 1 << 8;
+
+	static constexpr Word interrupt_id = 0x9;
+
+	/// Transmitted bytes are flushed once this many are buffered, or on `sync`
+	static constexpr std::size_t tx_buffer_size = 64 * 1024;
+
+	static constexpr std::size_t rx_queue_size = 4096;
+
+	/// Called with batches of transmitted bytes.
+	std::function<void(std::string_view)> on_transmit;
+
+	/// Called from the producer thread when a byte is received while interrupts are enabled.
+	std::function<void()> on_interrupt;
+
+	Uart() { m_tx_buffer.reserve(tx_buffer_size); }
+
+	/// Flushes the remaining transmitted bytes.
+	~Uart() { flush(); }
+
+	Uart(const Uart&)                    = delete;
+	auto operator=(const Uart&) -> Uart& = delete;
+
+	void attach(MmioBus& bus);
+
+	/// Queues received bytes, dropping them if the queue is full. Must always be called from the same thread.
+	void receive(std::span<const u8> bytes);
+
+	/// Hands the buffered transmitted bytes to `on_transmit`.
+	void flush();
+
+	/// Called between slices, flushes so that output keeps flowing while the guest runs.
+	void sync() { flush(); }
+
+	auto read(Addr offset, AccessGranularity granularity) -> std::pair<AccessStatus, u32>;
+	auto write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus;
+
+	/// Flushes, then saves the control register for a snapshot. Received bytes come from the host, and are not saved.
+	void save_state(StateWriter& w);
+	void load_state(StateReader& r);
+
+	private:
+	std::string m_tx_buffer;
+
+	SpscRing<u8, rx_queue_size> m_rx_queue;
+
+	std::atomic<u32> m_control{0};
+};
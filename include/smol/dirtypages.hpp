@@ -0,0 +1,80 @@
+#pragma once
+
+#include <smol/types.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/// Pages of guest RAM written to since they were last collected, attached to an `Mmu`, e.g. for incremental
+/// checkpoints.
+///
+/// Each page has its own byte rather than a bit, so that marking is a single plain store rather than a read-modify-write
+/// that cores sharing RAM would have to synchronize. Each bit of the byte is a channel, so that up to `channel_count`
+/// consumers collect pages independently.
+struct DirtyPages
+{
+	static constexpr std::size_t page_size     = 4096;
+	static constexpr unsigned    page_shift    = 12;
+	static constexpr unsigned    channel_count = 8;
+
+	explicit DirtyPages(std::size_t ram_size) : m_pages(ram_size >> page_shift) {}
+
+	/// Returns a channel for a new consumer. Throws `std::runtime_error` once all are taken.
+	auto open_channel() -> unsigned
+	{
+		if (m_channels == channel_count)
+		{
+			throw std::runtime_error{"No dirty page tracking channel left"};
+		}
+
+		return m_channels++;
+	}
+
+	void mark(Addr addr) { std::atomic_ref<u8>(m_pages[addr >> page_shift]).store(0xFF, std::memory_order_relaxed); }
+
+	/// Marks every page overlapping `[addr; addr + length)`, which must lie within RAM.
+	void mark_range(Addr addr, std::size_t length)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+
+		const std::size_t last = (std::size_t(addr) + length - 1) >> page_shift;
+
+		for (std::size_t page = addr >> page_shift; page <= last; ++page)
+		{
+			std::atomic_ref<u8>(m_pages[page]).store(0xFF, std::memory_order_relaxed);
+		}
+	}
+
+	void mark_all() { mark_range(0, m_pages.size() << page_shift); }
+
+	/// Returns the indices of the pages dirty on `channel` in ascending order, and marks them clean on it.
+	auto collect(unsigned channel) -> std::vector<u32>
+	{
+		std::vector<u32> ret;
+		const u8         bit = u8(1 << channel);
+
+		for (std::size_t page = 0; page < m_pages.size(); ++page)
+		{
+			std::atomic_ref<u8> dirty(m_pages[page]);
+
+			// Only dirty pages pay for the read-modify-write
+			if ((dirty.load(std::memory_order_relaxed) & bit) != 0
+				&& (dirty.fetch_and(u8(~bit), std::memory_order_relaxed) & bit) != 0)
+			{
+				ret.push_back(u32(page));
+			}
+		}
+
+		return ret;
+	}
+
+	private:
+	std::vector<u8> m_pages;
+	unsigned        m_channels = 0;
+};
@@ -2,10 +2,12 @@
 
 #ifdef SMOLISA_FRAMEBUFFER
 
+#	include <smol/snapshot.hpp>
 #	include <smol/types.hpp>
 
 #	include <SFML/Graphics.hpp>
 #	include <cstddef>
+#	include <functional>
 #	include <optional>
 #	include <vector>
 
@@ -61,11 +63,17 @@ class FrameBuffer
 	void set_palette_entry(std::size_t index, PaletteEntry entry);
 	auto get_palette_entry(std::size_t index) const -> PaletteEntry;
 
+	/// Called with each character typed into the window.
+	std::function<void(u8)> on_text_entered;
+
 	explicit FrameBuffer(FrameBufferConfig config = {});
 
 	void clear();
 	void rebuild();
 	auto display() -> bool;
+
+	/// Handles pending window events, without presenting. Returns false once the window was closed.
+	auto poll_events() -> bool;
 	auto should_present() -> bool;
 
 	void update_char(Char c, std::size_t x, std::size_t y);
@@ -77,6 +85,12 @@ class FrameBuffer
 	auto set_byte(Addr a, u8 b) -> bool;
 	auto get_byte(Addr a) const -> std::optional<u8>;
 
+	/// Saves the character and palette data for a snapshot.
+	void save_state(StateWriter& w) const;
+
+	/// Restores what `save_state` saved, and redraws the whole screen.
+	void load_state(StateReader& r);
+
 	private:
 	std::vector<char> m_character_data;
 	std::vector<char> m_palette_data;
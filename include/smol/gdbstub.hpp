@@ -0,0 +1,85 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/types.hpp>
+#include <smol/watchpoints.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// GDB remote serial protocol stub serving a single client over TCP or a Unix socket.
+///
+/// Registers are exposed in order as `r0`..`r12`, `rret`, `rpl`, `rps`, `rip` and `t` (0 or 1), all 32-bit little
+/// endian. Memory accesses are restricted to RAM, so that inspecting memory never triggers MMIO side effects.
+///
+/// Breakpoints are kept aside rather than written into RAM, so that neither the guest nor the client ever sees them in
+/// memory. While any is set, `rip` is checked before each instruction through `Core::instruction_hook`, and only
+/// compared against individual breakpoints when its 4 KiB page holds one. Watchpoints are attached to the `Mmu` as a
+/// `WatchpointSet`, so that only accesses to watched pages are checked.
+///
+/// The target runs through `Core::run`, checking for an interrupt request (^C) from the client every `poll_interval`
+/// instructions. A guest halt is reported as the target exiting with its status.
+struct GdbStub
+{
+	Core& core;
+
+	explicit GdbStub(Core& core);
+	~GdbStub();
+
+	GdbStub(const GdbStub&)                    = delete;
+	auto operator=(const GdbStub&) -> GdbStub& = delete;
+
+	/// Waits for a client on `endpoint`, either a TCP port number (bound to localhost) or `unix:<path>`.
+	/// Throws `std::runtime_error` on socket errors.
+	void accept(std::string_view endpoint);
+
+	/// Serves requests until the client detaches, kills the target or disconnects.
+	void serve();
+
+	/// Instructions run between two checks for an interrupt request from the client.
+	static constexpr std::uint64_t poll_interval = 65536;
+
+	private:
+	struct StopReason
+	{
+		int                       signal = 5; // SIGTRAP
+		std::optional<Watchpoint> watchpoint;
+		Addr                      watch_addr = 0;
+	};
+
+	auto receive_packet() -> std::optional<std::string>;
+	void send_packet(std::string_view data);
+	auto handle_packet(std::string_view packet) -> bool;
+
+	void resume(bool single_step);
+	void step();
+	auto interrupt_requested() -> bool;
+	auto stop_reply() const -> std::string;
+
+	auto read_register(std::size_t index) const -> std::optional<Word>;
+	auto write_register(std::size_t index, Word value) -> bool;
+	auto read_memory(Addr addr, std::size_t length) const -> std::optional<std::vector<u8>>;
+	auto write_memory(Addr addr, const std::vector<u8>& data) -> bool;
+
+	auto insert_breakpoint(Addr addr) -> bool;
+	auto remove_breakpoint(Addr addr) -> bool;
+	void update_instruction_hook();
+
+	int  m_listen_fd   = -1;
+	int  m_fd          = -1;
+	bool m_ack_enabled = true;
+
+	std::string m_unix_path;
+
+	std::set<Addr>  m_breakpoints;
+	std::vector<u8> m_breakpoint_pages;
+	WatchpointSet   m_watchpoints;
+
+	bool       m_ignore_brk = false;
+	bool       m_stopped    = false;
+	StopReason m_stop;
+};
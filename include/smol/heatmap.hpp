@@ -0,0 +1,64 @@
+#pragma once
+
+#include <smol/memory.hpp>
+#include <smol/types.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Per 4 KiB RAM page and per MMIO address access counters, attached to an `Mmu`.
+struct MemoryHeatmap
+{
+	static constexpr std::size_t page_size  = 4096;
+	static constexpr unsigned    page_shift = 12;
+
+	struct Counters
+	{
+		std::uint64_t reads   = 0;
+		std::uint64_t writes  = 0;
+		std::uint64_t fetches = 0;
+
+		/// Instruction counts of the first and last access; `first_touch` is `untouched` until any access occurs
+		std::uint64_t first_touch = untouched;
+		std::uint64_t last_touch  = 0;
+
+		static constexpr std::uint64_t untouched = std::numeric_limits<std::uint64_t>::max();
+	};
+
+	std::vector<Counters>    pages;
+	std::map<Addr, Counters> mmio;
+
+	/// `instruction_counter` is sampled for first/last touch timestamps, normally `Core::executed_ops`.
+	explicit MemoryHeatmap(const std::size_t& instruction_counter);
+
+	void record(Addr addr, AccessKind kind)
+	{
+		auto& counters = addr >= Mmu::mmio_start_address ? mmio[Mmu::mmio_address(addr)] : pages[addr >> page_shift];
+
+		switch (kind)
+		{
+		case AccessKind::Fetch: ++counters.fetches; break;
+		case AccessKind::Load: ++counters.reads; break;
+		case AccessKind::Store: ++counters.writes; break;
+		}
+
+		if (counters.first_touch == Counters::untouched)
+		{
+			counters.first_touch = m_clock;
+		}
+
+		counters.last_touch = m_clock;
+	}
+
+	/// Writes touched pages and MMIO addresses as CSV, one per row:
+	/// `region,address,reads,writes,fetches,first_touch,last_touch` where `region` is `page` or `mmio`.
+	/// Throws `std::runtime_error` if the file cannot be written.
+	void dump_csv(std::string_view path) const;
+
+	private:
+	const std::size_t& m_clock;
+};
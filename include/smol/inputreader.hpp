@@ -0,0 +1,33 @@
+#pragma once
+
+#include <smol/types.hpp>
+
+#include <atomic>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <thread>
+
+/// Host thread reading a file, pipe or stdin as data comes in, e.g. to feed guest input devices.
+struct InputReader
+{
+	/// Called from the reader thread with each chunk read.
+	using Handler = std::function<void(std::span<const u8>)>;
+
+	/// Starts reading `path`, or stdin if `path` is `-`, until the end of the input. Throws `std::runtime_error` if
+	/// `path` cannot be opened.
+	InputReader(std::string_view path, Handler handler);
+
+	/// Stops reading, without waiting for more input.
+	~InputReader();
+
+	InputReader(const InputReader&)                    = delete;
+	auto operator=(const InputReader&) -> InputReader& = delete;
+
+	private:
+	void read_loop(int fd);
+
+	Handler           m_handler;
+	std::atomic<bool> m_stopping{false};
+	std::thread       m_thread;
+};
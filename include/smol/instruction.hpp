@@ -6,6 +6,7 @@
 #include <smol/types.hpp>
 
 #include <array>
+#include <string_view>
 #include <type_traits>
 #include <variant>
 #include <fmt/core.h>
@@ -36,12 +37,12 @@ namespace decoders
 
 using R = RegisterId;
 
-void r4(Instruction ins, RegisterId& r)
+inline void r4(Instruction ins, RegisterId& r)
 {
 	r = bits<R>(ins, 0, 4);
 }
 
-void r4r4(Instruction ins, RegisterId& a, RegisterId& b)
+inline void r4r4(Instruction ins, RegisterId& a, RegisterId& b)
 {
 	a = bits<R>(ins, 0, 4);
 	b = bits<R>(ins, 4, 4);
@@ -672,6 +673,21 @@ struct BASRI : formats::ALURegS5
 	using formats::ALURegS5::ALURegS5;
 };
 
+struct LL32 : formats::MemLoad
+{
+	using formats::MemLoad::MemLoad;
+};
+
+struct SC32 : formats::MemStore
+{
+	using formats::MemStore::MemStore;
+};
+
+struct FENCE : formats::NoArg
+{
+	using formats::NoArg::NoArg;
+};
+
 struct INTOFF : formats::NoArg
 {
 	using formats::NoArg::NoArg;
@@ -768,6 +784,9 @@ using AnyInstruction = std::variant<
 	BSLI,
 	BSRITLSB,
 	BASRI,
+	LL32,
+	SC32,
+	FENCE,
 	INTOFF,
 	INTON,
 	INTRET,
@@ -775,6 +794,86 @@ using AnyInstruction = std::variant<
 	Unknown
 >;
 
+/// Assembler mnemonics, indexed by `AnyInstruction::index()`.
+constexpr std::array<std::string_view, std::variant_size_v<AnyInstruction>> mnemonics = {
+	"l8",      "l16",     "l32",     "c_lr",      "l8ow",      "l16ow",  "l32ow",  "lr",      "ls8",
+	"ls16",    "ls8ow",   "ls16ow",  "l8o",       "l16o",      "l32o",   "ls8o",   "ls16o",   "lsi",
+	"lsih",    "lsiw",    "liprel",  "s8",        "s16",       "s32",    "push",   "s8ow",    "s16ow",
+	"s32ow",   "brk",     "s8o",     "s16o",      "s32o",      "tltu",   "tlts",   "tgeu",    "tges",
+	"te",      "tne",     "tgtu",    "tgts",      "tltsi",     "tgesi",  "tei",    "tnei",    "pl_l32",
+	"j",       "c_j",     "jal",     "jali",      "c_ji",      "bsext8", "bsext16", "bzext8", "bzext16",
+	"ineg",    "isub",    "iadd",    "iaddsi",    "iaddsiw",   "iaddsi_tnz", "band", "bor",    "bxor",
+	"bsl",     "bsr",     "basr",    "bsli",      "bsri_tlsb", "basri",  "ll32",   "sc32",    "fence",
+	"intoff",  "inton",   "intret",  "intwait",   "unknown"};
+
+static_assert(mnemonics.back() == "unknown", "mnemonics must match AnyInstruction alternatives");
+
+enum class InstructionClass
+{
+	Load,
+	Store,
+	Alu,
+	Test,
+	Branch, ///< Conditional branches (`c_j`, `c_ji`)
+	Jump,   ///< Unconditional jumps and calls (`j`, `jal`, `jali`)
+	System,
+	Count
+};
+
+static constexpr std::array<std::string_view, std::size_t(InstructionClass::Count)> instruction_class_names = {
+	"load", "store", "alu", "test", "branch", "jump", "system"};
+
+template<class T>
+constexpr auto class_of() -> InstructionClass
+{
+	using namespace formats;
+
+	if constexpr (
+		std::is_base_of_v<MemLoad, T> || std::is_base_of_v<MemLoadWideOffset, T>
+		|| std::is_base_of_v<MemLoadShortOffset, T> || std::is_base_of_v<PoolLoad, T>)
+	{
+		return InstructionClass::Load;
+	}
+	else if constexpr (
+		std::is_base_of_v<MemStore, T> || std::is_base_of_v<MemStoreWideOffset, T>
+		|| std::is_base_of_v<MemStoreShortOffset, T> || std::is_base_of_v<StackPush, T>)
+	{
+		return InstructionClass::Store;
+	}
+	else if constexpr (std::is_base_of_v<TestRegReg, T> || std::is_base_of_v<TestRegI4, T>)
+	{
+		return InstructionClass::Test;
+	}
+	else if constexpr (std::is_same_v<T, CJ> || std::is_same_v<T, CJI>)
+	{
+		return InstructionClass::Branch;
+	}
+	else if constexpr (std::is_same_v<T, J> || std::is_same_v<T, JAL> || std::is_same_v<T, JALI>)
+	{
+		return InstructionClass::Jump;
+	}
+	else if constexpr (std::is_base_of_v<NoArg, T> || std::is_same_v<T, Unknown>)
+	{
+		return InstructionClass::System;
+	}
+	else
+	{
+		return InstructionClass::Alu;
+	}
+}
+
+/// Instruction classes, indexed by `AnyInstruction::index()`.
+constexpr auto instruction_classes = []<std::size_t... I>(std::index_sequence<I...>) {
+	return std::array<InstructionClass, sizeof...(I)>{class_of<std::variant_alternative_t<I, AnyInstruction>>()...};
+}(std::make_index_sequence<std::variant_size_v<AnyInstruction>>{});
+
+inline auto classify(const AnyInstruction& insn) -> InstructionClass { return instruction_classes[insn.index()]; }
+
+inline auto instruction_length(const AnyInstruction& insn) -> std::size_t
+{
+	return std::visit([](const auto& x) { return x.length; }, insn);
+}
+
 // TODO: move to own file cause lol
 inline std::string disassemble(const AnyInstruction& insn)
 {
@@ -851,6 +950,9 @@ inline std::string disassemble(const AnyInstruction& insn)
 		[&](BSLI x) { return fmt::format("bsli(a_dst={}, b={})", rn(x.a_dst), x.b); },
 		[&](BSRITLSB x) { return fmt::format("bsri_tlsb(a_dst={}, b={})", rn(x.a_dst), x.b); },
 		[&](BASRI x) { return fmt::format("basri(a_dst={}, b={})", rn(x.a_dst), x.b); },
+		[&](LL32 x) { return fmt::format("ll32(addr={}, dst={})", rn(x.addr), rn(x.dst)); },
+		[&](SC32 x) { return fmt::format("sc32(addr={}, src={})", rn(x.addr), rn(x.src)); },
+		[&](FENCE x) { return fmt::format("fence()"); },
 		[&](INTOFF x) { return fmt::format("intoff()"); },
 		[&](INTON x) { return fmt::format("inton()"); },
 		[&](INTRET x) { return fmt::format("intret()"); },
@@ -936,6 +1038,9 @@ inline AnyInstruction decode(u32 insn)
 	if (o7 == 0b1101'0000) { return BSLI(insn); }
 	if (o7 == 0b1101'0010) { return BSRITLSB(insn); }
 	if (o7 == 0b1101'0100) { return BASRI(insn); }
+	if (o8 == 0b1101'0110) { return LL32(insn); }
+	if (o8 == 0b1101'0111) { return SC32(insn); }
+	if (o8 == 0b1101'1000) { return FENCE(insn); }
 	if (o8 == 0b1110'0000) { return INTOFF(insn); }
 	if (o8 == 0b1110'0001) { return INTON(insn); }
 	if (o8 == 0b1110'0010) { return INTRET(insn); }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <smol/ram.hpp>
 #include <smol/types.hpp>
 
 #include <functional>
@@ -15,6 +16,7 @@ enum class AccessStatus
 	ErrorMmioGranularity,
 	ErrorMmioPeripheralError,
 	ErrorMmioUnmapped,
+	ErrorAtomicMmio,
 	Count
 };
 
@@ -24,16 +26,40 @@ static constexpr std::array<std::string_view, int(AccessStatus::Count)> access_s
 	"Misaligned memory access",
 	"Illegal granularity for MMIO address",
 	"Illegal address for MMIO peripheral",
-	"Unmapped MMIO address"
+	"Unmapped MMIO address",
+	"Atomic access to MMIO address"
 };
 
 enum class AccessGranularity
 {
 	U8,
 	U16,
-	U32
+	U32,
+	Count
+};
+
+enum class AccessKind
+{
+	Fetch,
+	Load,
+	Store
 };
 
+#ifdef SMOLISA_STATS
+struct MemoryStats
+{
+	/// Data access counters, indexed by `[AccessGranularity][is_mmio]`.
+	using Counters = std::array<std::array<std::uint64_t, 2>, std::size_t(AccessGranularity::Count)>;
+
+	Counters loads  = {};
+	Counters stores = {};
+};
+#endif
+
+struct DirtyPages;
+struct MemoryHeatmap;
+struct WatchpointSet;
+
 struct Mmu
 {
 	static constexpr auto address_space_size = (std::uint64_t(1) << (sizeof(Word) * 8));
@@ -43,11 +69,28 @@ struct Mmu
 
 	static constexpr auto mmio_address(Addr real_address) -> Addr { return real_address - mmio_start_address; }
 
-	std::vector<u8> ram;
+	GuestRam ram;
 
 	std::function<std::pair<AccessStatus, u32>(Addr, AccessGranularity)>       mmio_read_callback;
 	std::function<AccessStatus(Addr, u32, AccessGranularity)>                  mmio_write_callback;
 
+	/// Observes every instruction fetch and data access that passes mapping and alignment checks, e.g. for cache
+	/// simulation. When empty, accesses only pay for the emptiness check.
+	std::function<void(Addr, AccessGranularity, AccessKind)> access_hook;
+
+	/// Optional per page and MMIO address access counters, fed with the same accesses as `access_hook` when set.
+	MemoryHeatmap* heatmap = nullptr;
+
+	/// Optional data watchpoints. Only accesses to pages they cover pay for checking them.
+	WatchpointSet* watchpoints = nullptr;
+
+	/// Optional tracking of written RAM pages. Host code writing to `ram` directly must report it to `mark_dirty`.
+	DirtyPages* dirty_pages = nullptr;
+
+#ifdef SMOLISA_STATS
+	mutable MemoryStats stats;
+#endif
+
 	explicit Mmu();
 
 	[[nodiscard]] auto is_mmio(Addr addr) const -> bool { return addr >= mmio_start_address; };
@@ -61,4 +104,48 @@ struct Mmu
 
 	[[nodiscard]] auto get_u32(Addr addr) const -> std::pair<AccessStatus, u32>;
 	auto               set_u32(Addr addr, u32 data) -> AccessStatus;
+
+	/// Atomically replaces the u32 at `addr` with `desired` if it holds `expected`, see `doc/memory-model.md`.
+	/// Returns whether it did. Only valid on RAM.
+	auto compare_exchange_u32(Addr addr, u32 expected, u32 desired) -> std::pair<AccessStatus, bool>;
+
+	/// Instruction fetch; behaves like `get_u16` but is not accounted as a data access.
+	[[nodiscard]] auto fetch_u16(Addr addr) const -> std::pair<AccessStatus, u16>;
+
+	/// Speculative instruction fetch; behaves like `fetch_u16` but is not reported to `access_hook` or `heatmap`. The
+	/// fetched instruction is reported through `account_fetch` once its length is known.
+	[[nodiscard]] auto prefetch_u16(Addr addr) const -> std::pair<AccessStatus, u16>;
+
+	/// Reports the fetch of an instruction of `length` bytes at `addr` to `access_hook` and `heatmap`, as one access.
+	void account_fetch(Addr addr, std::size_t length) const
+	{
+		if (access_hook) [[unlikely]]
+		{
+			access_hook(addr, length == 4 ? AccessGranularity::U32 : AccessGranularity::U16, AccessKind::Fetch);
+		}
+
+		if (heatmap != nullptr) [[unlikely]]
+		{
+			record_fetch(addr);
+		}
+	}
+
+	/// Reports a write to `[addr; addr + length)` of RAM that bypassed the store path, e.g. by a device.
+	void mark_dirty(Addr addr, std::size_t length);
+
+	private:
+	void record_fetch(Addr addr) const;
+
+	template<class T>
+	[[nodiscard]] auto read(Addr addr, AccessKind kind) const -> std::pair<AccessStatus, T>;
+
+	template<class T>
+	auto write(Addr addr, T data) -> AccessStatus;
+
+	/// Performs an access that already passed mapping and alignment checks.
+	template<class T>
+	[[nodiscard]] auto load(Addr addr) const -> std::pair<AccessStatus, T>;
+
+	template<class T>
+	auto store(Addr addr, T data) -> AccessStatus;
 };
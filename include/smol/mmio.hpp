@@ -0,0 +1,45 @@
+#pragma once
+
+#include <smol/memory.hpp>
+#include <smol/types.hpp>
+
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Dispatches MMIO accesses of an `Mmu` to the devices mapped over the MMIO address space.
+///
+/// Addresses are relative to `Mmu::mmio_start_address` on the bus side, and relative to the start of the mapping on
+/// the device side.
+struct MmioBus
+{
+	using ReadHandler  = std::function<std::pair<AccessStatus, u32>(Addr offset, AccessGranularity granularity)>;
+	using WriteHandler = std::function<AccessStatus(Addr offset, u32 data, AccessGranularity granularity)>;
+
+	struct Mapping
+	{
+		std::string_view name;
+		Addr             base;
+		Addr             size;
+		ReadHandler      read;
+		WriteHandler     write;
+	};
+
+	/// Maps a device over `[base; base + size)`. Throws `std::runtime_error` if it overlaps an existing mapping.
+	void map(std::string_view name, Addr base, Addr size, ReadHandler read, WriteHandler write);
+
+	[[nodiscard]] auto read(Addr addr, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>;
+	auto               write(Addr addr, u32 data, AccessGranularity granularity) const -> AccessStatus;
+
+	/// Routes the MMIO callbacks of `mmu` to this bus, which must outlive it.
+	void attach(Mmu& mmu) const;
+
+	[[nodiscard]] auto mappings() const -> const std::vector<Mapping>& { return m_mappings; }
+
+	private:
+	[[nodiscard]] auto find(Addr addr) const -> const Mapping*;
+
+	/// Sorted by base address
+	std::vector<Mapping> m_mappings;
+};
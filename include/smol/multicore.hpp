@@ -0,0 +1,58 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/types.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// Several cores sharing the RAM and MMIO devices of a boot core, each run on its own host thread.
+///
+/// Every core starts at the `rip` of the boot core, with `r0` holding its index. RAM accesses follow
+/// `doc/memory-model.md`; MMIO accesses are serialized, so that devices need not be thread-safe.
+struct Multicore
+{
+	/// `boot_core` becomes core 0. Its MMIO callbacks and `sync_devices` must already be set up, and it must outlive
+	/// this.
+	Multicore(Core& boot_core, std::size_t core_count);
+
+	Multicore(const Multicore&)                    = delete;
+	auto operator=(const Multicore&) -> Multicore& = delete;
+
+	/// Cores by index; the first one is the boot core.
+	std::vector<Core*> cores;
+
+	/// Makes `size` bytes of MMIO at `addr` (a bus offset, e.g. `IntervalTimer::mmio_address`) only accessible from the
+	/// boot core, for devices that read or drive its state directly. Accesses from other cores fail with
+	/// `AccessStatus::ErrorMmioPeripheralError`. Must be called before `run`.
+	void restrict_to_boot_core(Addr addr, Addr size);
+
+	/// Raises `interrupt_id` on the core at `index`. Thread-safe.
+	void interrupt(std::size_t index, Word interrupt_id);
+
+	/// Halts every core with `status`. Thread-safe.
+	void halt(Word status);
+
+	/// Runs every core on its own thread until all of them stop, and returns why each did. A halt or an error on any
+	/// core halts the others with the same status, and errors are rethrown once all threads are joined.
+	auto run(const RunLimits& limits) -> std::vector<StopReason>;
+
+	[[nodiscard]] auto executed_ops() const -> std::uint64_t;
+
+	private:
+	struct MmioRange
+	{
+		Addr addr;
+		Addr size;
+	};
+
+	[[nodiscard]] auto is_boot_core_only(Addr addr) const -> bool;
+
+	std::vector<std::unique_ptr<Core>> m_secondaries;
+	std::vector<MmioRange>             m_boot_core_only;
+
+	std::mutex m_mmio_mutex;
+};
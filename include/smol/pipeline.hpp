@@ -0,0 +1,140 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/instruction.hpp>
+#include <smol/types.hpp>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+struct PipelineConfig
+{
+	/// Forward results from EX and MEM back to EX. Without forwarding, consumers wait for their producers to retire.
+	bool forwarding = true;
+};
+
+enum class PipelineStage
+{
+	Fetch,
+	Decode,
+	Execute,
+	Memory,
+	WriteBack,
+	Count
+};
+
+static constexpr std::array<std::string_view, std::size_t(PipelineStage::Count)> pipeline_stage_names = {
+	"IF", "ID", "EX", "MEM", "WB"};
+
+/// Reasons for which no instruction entered EX during a cycle.
+enum class StallCause
+{
+	LoadUse,        ///< Data hazard on the result of a load still in MEM
+	DataHazard,     ///< Data hazard that forwarding would have covered
+	Control,        ///< Refetch after a taken branch, jump, exception or `intret`
+	ExtensionFetch, ///< Fetching the `Ex` extension word of the next instruction
+	Count
+};
+
+static constexpr std::array<std::string_view, std::size_t(StallCause::Count)> stall_cause_names = {
+	"load-use", "data hazard", "control", "extension fetch"};
+
+struct PipelineStats
+{
+	std::uint64_t cycles  = 0;
+	std::uint64_t retired = 0;
+
+	std::uint64_t extension_fetches    = 0;
+	std::uint64_t flushes              = 0;
+	std::uint64_t flushed_instructions = 0;
+
+	/// Cycles during which each stage held an instruction.
+	std::array<std::uint64_t, std::size_t(PipelineStage::Count)> busy = {};
+
+	std::array<std::uint64_t, std::size_t(StallCause::Count)> stalls = {};
+};
+
+/// Cycle-level model of a classic in-order 5-stage pipeline (IF, ID, EX, MEM, WB).
+///
+/// Instructions are fetched 16 bits per cycle, speculatively down the sequential path, decoded with `insns::decode` and
+/// checked for hazards in ID. They are executed in EX by `Core::execute` on the wrapped core, which holds the
+/// architectural state and `Mmu`; control flow is resolved there, and younger instructions are flushed on redirects.
+///
+/// With `enable_lockstep`, a separate reference `Core` runs the same program one instruction at a time, and the
+/// architectural state of both is compared after each instruction. MMIO reads observed by the pipeline are replayed to
+/// the reference, and its MMIO writes are discarded. Interrupts pending on the pipeline are mirrored to the reference.
+struct PipelinedCore
+{
+	PipelineConfig config;
+	PipelineStats  stats;
+
+	Core& core;
+
+	explicit PipelinedCore(Core& core, PipelineConfig config = {});
+
+	/// Compares against `reference` after every instruction. `reference` must start from the same state as `core`.
+	void enable_lockstep(Core& reference);
+
+	void cycle();
+
+	/// Cycles until the core halts or a limit is reached, like `Core::run`. Pending interrupts, `sync_devices`, limits
+	/// and `keepalive` are handled every `Core::slice_length` instructions, or earlier on device deadlines.
+	auto boot(const RunLimits& limits = {}) -> StopReason;
+
+	[[nodiscard]] auto report() const -> std::string;
+
+	private:
+	struct RegisterUsage
+	{
+		/// Bitmasks of registers, with bit 16 standing for the `T` bit
+		u32 reads  = 0;
+		u32 writes = 0;
+	};
+
+	struct Slot
+	{
+		Addr                  rip    = 0;
+		Instruction           raw    = 0;
+		insns::AnyInstruction insn   = insns::Unknown{};
+		std::size_t           length = 2;
+		RegisterUsage         usage;
+		bool                  is_load     = false;
+		bool                  fetch_fault = false;
+	};
+
+	struct FetchSlot
+	{
+		Slot slot;
+		bool complete = false;
+	};
+
+	static auto register_usage(const insns::AnyInstruction& insn) -> RegisterUsage;
+
+	void fetch();
+	void finish_fetch(Slot& slot);
+	auto hazard(const Slot& consumer) const -> std::optional<StallCause>;
+	void execute(Slot& slot);
+	void flush(Addr target);
+	void deliver_interrupts();
+	void mirror_interrupts();
+	void check_lockstep(const Slot& slot);
+
+	std::optional<FetchSlot> m_if;
+	std::optional<Slot>      m_id;
+	std::optional<Slot>      m_ex;
+	std::optional<Slot>      m_mem;
+	std::optional<Slot>      m_wb;
+
+	Addr       m_fetch_rip    = 0;
+	StallCause m_bubble_cause = StallCause::Control;
+
+	Core* m_reference = nullptr;
+
+	/// MMIO access results of the pipeline, in order, to be replayed to the lockstep reference
+	std::deque<std::pair<AccessStatus, u32>> m_mmio_log;
+};
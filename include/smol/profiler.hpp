@@ -0,0 +1,79 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/instruction.hpp>
+#include <smol/symbols.hpp>
+#include <smol/types.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct ProfilerConfig
+{
+	/// Number of executed instructions between two samples of `rip`.
+	std::uint64_t interval = 1009;
+
+	/// Calls nested deeper than this are not tracked by the shadow call stack.
+	std::size_t max_depth = 256;
+};
+
+/// Statistical profiler sampling `rip` every `interval` instructions.
+///
+/// A shadow call stack follows `jal`/`jali` as calls and jumps back to a pending return address, typically `j rret`,
+/// as returns. Each sample records the stack of callee entry points along with the sampled `rip`.
+struct Profiler
+{
+	ProfilerConfig config;
+	SymbolMap      symbols;
+
+	std::uint64_t samples = 0;
+
+	explicit Profiler(SymbolMap symbols, ProfilerConfig config = {});
+
+	/// Called by `Core::execute` after executing `insn`, before `rip` is updated to `core.next_rip`.
+	void account(const Core& core, const insns::AnyInstruction& insn)
+	{
+		using namespace insns;
+
+		// Sample first so that calls and returns are attributed to the caller and callee respectively
+		if (--m_countdown == 0) [[unlikely]]
+		{
+			sample(core.rip);
+		}
+
+		if (std::holds_alternative<JAL>(insn) || std::holds_alternative<JALI>(insn) || std::holds_alternative<J>(insn)
+			|| std::holds_alternative<CJ>(insn)) [[unlikely]]
+		{
+			track_call_or_return(core, insn);
+		}
+	}
+
+	/// Samples in folded stack format (`outer;inner;leaf count` per line), as consumed by `flamegraph.pl`.
+	[[nodiscard]] auto folded_stacks() const -> std::string;
+
+	/// Flat per-label report of self and inclusive sample counts.
+	[[nodiscard]] auto report(std::size_t max_labels = 32) const -> std::string;
+
+	private:
+	struct Frame
+	{
+		Addr entry;
+		Addr return_address;
+	};
+
+	void track_call_or_return(const Core& core, const insns::AnyInstruction& insn);
+	void sample(Addr rip);
+
+	/// Resolved stack of a sample, outermost first, with the label of the sampled `rip` last.
+	[[nodiscard]] auto resolve_stack(const std::vector<Addr>& stack) const -> std::vector<std::string>;
+
+	std::uint64_t      m_countdown;
+	std::vector<Frame> m_stack;
+
+	/// Sample counts keyed by callee entry points, outermost first, followed by the sampled `rip`.
+	std::map<std::vector<Addr>, std::uint64_t> m_samples;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <smol/types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/// Read-only ROM file kept open so that any number of `GuestRam` can map it.
+struct RomImage
+{
+	std::string path;
+	std::size_t size = 0;
+
+	/// Throws `std::runtime_error` if `path` cannot be opened.
+	explicit RomImage(std::string_view path);
+	~RomImage();
+
+	RomImage(const RomImage&)                    = delete;
+	auto operator=(const RomImage&) -> RomImage& = delete;
+
+	[[nodiscard]] auto fd() const -> int { return m_fd; }
+
+	private:
+	int m_fd = -1;
+};
+
+/// Guest system memory, backed by an anonymous mapping that the host only commits as pages get touched.
+struct GuestRam
+{
+	static constexpr std::size_t page_size = 4096;
+
+	explicit GuestRam(std::size_t size);
+
+	/// Copies are deep, and commit every page of the copy.
+	GuestRam(const GuestRam& other);
+	auto operator=(const GuestRam& other) -> GuestRam&;
+
+	/// Makes this an alias of the memory of `other`, e.g. for cores sharing one address space. The mapping is
+	/// released along with its last alias.
+	void share(const GuestRam& other);
+
+	/// Maps `rom` copy-on-write at address 0. Until written to, its pages are shared with every other `GuestRam`
+	/// mapping the same ROM, and with the host page cache.
+	void map_rom(const RomImage& rom);
+
+	/// Zeroes all of RAM by mapping fresh anonymous memory over it, which releases every committed page.
+	void reset();
+
+	/// Maps `length` bytes of `fd` from `offset` copy-on-write at `addr`. All three must be multiples of `page_size`.
+	void map_file(int fd, std::uint64_t offset, std::size_t addr, std::size_t length);
+
+	[[nodiscard]] auto size() const -> std::size_t { return m_size; }
+
+	[[nodiscard]] auto data() -> u8* { return m_data; }
+	[[nodiscard]] auto data() const -> const u8* { return m_data; }
+
+	[[nodiscard]] auto begin() -> u8* { return m_data; }
+	[[nodiscard]] auto begin() const -> const u8* { return m_data; }
+	[[nodiscard]] auto end() -> u8* { return m_data + m_size; }
+	[[nodiscard]] auto end() const -> const u8* { return m_data + m_size; }
+
+	auto operator[](std::size_t i) -> u8& { return m_data[i]; }
+	auto operator[](std::size_t i) const -> const u8& { return m_data[i]; }
+
+	private:
+	std::shared_ptr<u8> m_mapping;
+	u8*                 m_data = nullptr;
+	std::size_t         m_size = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/dirtypages.hpp>
+#include <smol/ram.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/types.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/// Bounded history of machine states for time-travel debugging, see `doc/snapshots.md`.
+///
+/// Each entry holds the core and device state, and the RAM pages written since the previous entry as the XOR of their
+/// old and new contents, run-length encoded. As a XOR delta turns either state into the other, rewinding applies the
+/// deltas of the newest entries back over RAM. Keeping a shadow copy of RAM as of the newest entry makes taking a delta
+/// cost only as much as the pages written since.
+struct RewindBuffer
+{
+	/// Collects the pages written by `core` from its own channel of `dirty`, which must be attached to `core.mmu`.
+	/// Entries are dropped from the oldest on once they take more than `budget` bytes. With a non-zero `interval`,
+	/// `poll` records an entry every `interval` instructions. Records a first entry right away.
+	RewindBuffer(
+		Core& core, DirtyPages& dirty, std::vector<SnapshotDevice> devices, std::size_t budget, std::uint64_t interval);
+
+	/// Records an entry if `interval` instructions were executed since the previous one, e.g. between slices.
+	void poll();
+
+	/// Records an entry now, e.g. on every presented frame.
+	void record();
+
+	/// Restores the newest entry at or before instruction `target`, dropping the entries after it. Returns the
+	/// instruction count of the restored entry. Throws `std::runtime_error` if `target` predates the oldest entry.
+	auto rewind_to(std::uint64_t target) -> std::uint64_t;
+
+	/// Runs from the current state until instruction `target`, without calling `keepalive`. Replays what ran after
+	/// a rewind as long as the guest only depends on instruction-counted devices.
+	void replay_to(std::uint64_t target);
+
+	[[nodiscard]] auto oldest() const -> std::uint64_t { return m_entries.front().executed_ops; }
+	[[nodiscard]] auto newest() const -> std::uint64_t { return m_entries.back().executed_ops; }
+	[[nodiscard]] auto entry_count() const -> std::size_t { return m_entries.size(); }
+	[[nodiscard]] auto size_bytes() const -> std::size_t { return m_size; }
+
+	private:
+	struct Entry
+	{
+		std::uint64_t   executed_ops;
+		std::vector<u8> state;
+
+		/// XOR of the pages written since the previous entry, as `[u32 page][u32 size][size bytes of encoded XOR]`
+		std::vector<u8> delta;
+
+		[[nodiscard]] auto size() const -> std::size_t { return state.capacity() + delta.capacity(); }
+	};
+
+	/// Appends the XOR of `a` and `b` to `out`, as runs of `[u16 skipped zero words][u16 word count][words]`.
+	/// Returns false, leaving `out` as is, if the pages are identical.
+	static auto encode_xor(const u8* a, const u8* b, std::vector<u8>& out) -> bool;
+
+	/// XORs a delta written by `encode_xor` into `page`.
+	static void apply_xor(std::span<const u8> encoded, u8* page);
+
+	/// Applies the delta of `entry` to RAM and the shadow copy.
+	void apply_delta(const Entry& entry);
+
+	Core&                       m_core;
+	DirtyPages&                 m_dirty;
+	unsigned                    m_channel;
+	std::vector<SnapshotDevice> m_devices;
+	std::size_t                 m_budget;
+	std::uint64_t               m_interval;
+	std::uint64_t               m_next_at = 0;
+
+	/// RAM as of the newest entry
+	GuestRam m_shadow;
+
+	std::deque<Entry> m_entries;
+	std::size_t       m_size = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/types.hpp>
+
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Host services requested by the guest through `brk`, see `doc/semihosting.md`.
+///
+/// Files are confined to a sandbox directory: paths are resolved beneath it, and cannot escape it through `..` or
+/// symbolic links.
+struct Semihosting
+{
+	enum class Operation : Word
+	{
+		Exit    = 0x00,
+		Open    = 0x01,
+		Close   = 0x02,
+		Read    = 0x03,
+		Write   = 0x04,
+		Seek    = 0x05,
+		MemFill = 0x06,
+		MemCopy = 0x07,
+		Time    = 0x08,
+	};
+
+	/// Modes of `Open`
+	static constexpr Word open_read   = 0;
+	static constexpr Word open_write  = 1;
+	static constexpr Word open_append = 2;
+	static constexpr Word open_update = 3;
+
+	/// Returned in `r0` by failing operations
+	static constexpr Word error = 0xFFFF'FFFF;
+
+	static constexpr std::size_t max_path_length = 4096;
+
+	/// Throws `std::runtime_error` if `sandbox` is not an accessible directory.
+	explicit Semihosting(std::string_view sandbox);
+	~Semihosting();
+
+	Semihosting(const Semihosting&)                    = delete;
+	auto operator=(const Semihosting&) -> Semihosting& = delete;
+
+	/// Performs the operation requested by `core`, as a `Core::breakpoint_handler`. Never stops on the `brk`.
+	/// Thread-safe, so that several cores can share the handler.
+	auto handle(Core& core) -> bool;
+
+	private:
+	/// Returns the guest range `[addr; addr + length)` if it lies within RAM.
+	[[nodiscard]] static auto guest_range(Core& core, Addr addr, Word length) -> std::optional<std::span<u8>>;
+
+	/// Returns the NUL-terminated string at `addr`.
+	[[nodiscard]] static auto guest_string(Core& core, Addr addr) -> std::optional<std::string>;
+
+	auto open(Core& core, Addr path, Word mode) -> Word;
+	auto close(Word handle) -> Word;
+	auto transfer(Core& core, Operation op, Word handle, Addr buffer, Word length) -> Word;
+	auto seek(Word handle, Word offset) -> Word;
+
+	/// Returns the host file descriptor of `handle`, or -1.
+	[[nodiscard]] auto file(Word handle) const -> int;
+
+	std::mutex m_mutex;
+
+	int m_sandbox = -1;
+
+	/// Host file descriptors indexed by guest handle, -1 for free handles
+	std::vector<int> m_files;
+};
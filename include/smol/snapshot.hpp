@@ -0,0 +1,133 @@
+#pragma once
+
+#include <smol/core.hpp>
+#include <smol/dirtypages.hpp>
+#include <smol/types.hpp>
+
+#include <cstring>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/// Serializes the state of a device or core into a flat byte buffer.
+struct StateWriter
+{
+	std::vector<u8> data;
+
+	void put_bytes(const void* bytes, std::size_t size)
+	{
+		const auto* p = static_cast<const u8*>(bytes);
+		data.insert(data.end(), p, p + size);
+	}
+
+	template<class T>
+	void put(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		put_bytes(&value, sizeof(T));
+	}
+};
+
+/// Reads back what a `StateWriter` wrote, in the same order. Throws `std::runtime_error` past the end of the data.
+struct StateReader
+{
+	std::span<const u8> data;
+
+	void get_bytes(void* bytes, std::size_t size)
+	{
+		if (data.size() < size)
+		{
+			throw std::runtime_error{"Truncated snapshot state"};
+		}
+
+		std::memcpy(bytes, data.data(), size);
+		data = data.subspan(size);
+	}
+
+	template<class T>
+	auto get() -> T
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+		T ret;
+		get_bytes(&ret, sizeof(T));
+		return ret;
+	}
+};
+
+/// Device whose state is saved along with a snapshot, under a name unique to the machine.
+struct SnapshotDevice
+{
+	std::string_view                  name;
+	std::function<void(StateWriter&)> save;
+	std::function<void(StateReader&)> load;
+};
+
+/// Machine snapshots, see `doc/snapshots.md`.
+///
+/// RAM is stored sparsely, as page-aligned runs of its non-zero pages, so that restoring maps the file copy-on-write
+/// into guest RAM rather than reading it.
+namespace snapshot
+{
+/// Saves `core` and `devices`, as sections named after them. RAM is left out.
+[[nodiscard]] auto save_state(const Core& core, const std::vector<SnapshotDevice>& devices) -> StateWriter;
+
+/// Restores what `save_state` saved, skipping sections of unknown devices. The core is restored first.
+void load_state(std::span<const u8> state, Core& core, const std::vector<SnapshotDevice>& devices);
+
+/// Whether the file at `path` looks like a snapshot.
+[[nodiscard]] auto is_snapshot(std::string_view path) -> bool;
+
+/// Writes the core, its RAM and `devices` to `path`. Throws `std::runtime_error` on failure.
+void save(std::string_view path, const Core& core, const std::vector<SnapshotDevice>& devices);
+
+/// Writes an incremental snapshot to `path`, holding the core, `devices` and only the RAM `pages` (indices in ascending
+/// order), to be applied over the RAM of the snapshot at `parent`. Throws `std::runtime_error` on failure.
+void save_incremental(
+	std::string_view                   path,
+	const Core&                        core,
+	const std::vector<SnapshotDevice>& devices,
+	std::string_view                   parent,
+	std::span<const u32>               pages);
+
+/// Restores what `save` or `save_incremental` wrote, following the chain of parents of incremental snapshots. State saved for devices missing from `devices` is ignored, and devices missing from
+/// the snapshot keep their state. Throws `std::runtime_error` on failure, possibly leaving `core` half-restored.
+void load(std::string_view path, Core& core, const std::vector<SnapshotDevice>& devices);
+
+/// Periodic checkpoints of a long run, written as `<prefix>.<n>.snap`: a full snapshot first, then incremental ones
+/// holding the pages written since the previous checkpoint, each chained to it. Any of them can be resumed, as long as
+/// those before it are kept.
+struct Checkpointer
+{
+	/// Collects the pages written by `core` from its own channel of `dirty`, which must be attached to `core.mmu`.
+	Checkpointer(
+		Core& core, DirtyPages& dirty, std::vector<SnapshotDevice> devices, std::string prefix, std::uint64_t interval);
+
+	Checkpointer(const Checkpointer&)                    = delete;
+	auto operator=(const Checkpointer&) -> Checkpointer& = delete;
+
+	/// Checkpoints if `interval` instructions were executed since the previous checkpoint, e.g. between slices.
+	void poll();
+
+	/// Checkpoints now, returning the path written to. Throws `std::runtime_error` on failure, after which the next
+	/// checkpoint is a full snapshot.
+	auto checkpoint() -> std::string;
+
+	private:
+	Core&                       m_core;
+	DirtyPages&                 m_dirty;
+	unsigned                    m_channel;
+	std::vector<SnapshotDevice> m_devices;
+	std::string                 m_prefix;
+	std::uint64_t               m_interval;
+
+	std::uint64_t m_next_at;
+	std::size_t   m_count = 0;
+
+	/// Path of the previous checkpoint, empty until the first one succeeds
+	std::string m_previous;
+};
+} // namespace snapshot
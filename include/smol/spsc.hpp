@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+/// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+///
+/// The producer only writes the tail and the consumer only writes the head, so neither side ever waits on the other.
+/// Both indices increase forever and wrap around `Capacity` when indexing.
+template<class T, std::size_t Capacity>
+struct SpscRing
+{
+	static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	static constexpr std::size_t capacity = Capacity;
+
+	/// Producer side. Returns false, dropping `item`, if the queue is full.
+	auto push(const T& item) -> bool
+	{
+		const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+		{
+			return false;
+		}
+
+		m_items[tail % Capacity] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Consumer side.
+	auto pop() -> std::optional<T>
+	{
+		const std::size_t head = m_head.load(std::memory_order_relaxed);
+
+		if (head == m_tail.load(std::memory_order_acquire))
+		{
+			return std::nullopt;
+		}
+
+		const T item = m_items[head % Capacity];
+		m_head.store(head + 1, std::memory_order_release);
+		return item;
+	}
+
+	/// Exact from the consumer side; a lower bound from the producer side.
+	[[nodiscard]] auto size() const -> std::size_t
+	{
+		return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+	}
+
+	private:
+	std::array<T, Capacity> m_items{};
+
+	// Kept on separate cache lines so that both sides do not keep stealing the line from each other
+	alignas(64) std::atomic<std::size_t> m_head{0};
+	alignas(64) std::atomic<std::size_t> m_tail{0};
+};
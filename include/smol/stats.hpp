@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef SMOLISA_STATS
+
+#	include <smol/instruction.hpp>
+
+#	include <array>
+#	include <cstdint>
+#	include <string>
+#	include <variant>
+
+struct Core;
+
+struct BranchStats
+{
+	std::uint64_t taken     = 0;
+	std::uint64_t not_taken = 0;
+};
+
+struct ExecutionStats
+{
+	std::array<std::uint64_t, std::variant_size_v<insns::AnyInstruction>> op_counts = {};
+
+	BranchStats   cj;
+	BranchStats   cji;
+	std::uint64_t exceptions = 0;
+
+	/// Accounts for an instruction that was just executed. `t_bit` is the value the instruction observed.
+	void count(const insns::AnyInstruction& ins, bool t_bit)
+	{
+		++op_counts[ins.index()];
+
+		if (std::holds_alternative<insns::CJ>(ins))
+		{
+			++(t_bit ? cj.taken : cj.not_taken);
+		}
+		else if (std::holds_alternative<insns::CJI>(ins))
+		{
+			++(t_bit ? cji.taken : cji.not_taken);
+		}
+	}
+};
+
+/// Serializes execution and memory statistics of `core` as a JSON document.
+auto stats_to_json(const Core& core) -> std::string;
+
+/// Writes `stats_to_json(core)` to `path`.
+void dump_stats(const Core& core, std::string_view path);
+
+#endif
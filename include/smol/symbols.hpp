@@ -0,0 +1,21 @@
+#pragma once
+
+#include <smol/types.hpp>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Address to label mapping, as written by the assembler's `Asm.write_labels`: one `<address> <name>` pair per line.
+struct SymbolMap
+{
+	/// Sorted by address
+	std::vector<std::pair<Addr, std::string>> symbols;
+
+	/// Throws `std::runtime_error` if the file cannot be read or is malformed.
+	static auto load(std::string_view path) -> SymbolMap;
+
+	/// Returns the closest label at or below `addr`, or `addr` in hexadecimal when there is none.
+	[[nodiscard]] auto resolve(Addr addr) const -> std::string;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/// Fixed set of worker threads with one task deque each. Workers run their own tasks newest first, and steal the
+/// oldest tasks of other workers once theirs run out, so that uneven tasks still keep every thread busy.
+///
+/// Tasks must not throw.
+struct ThreadPool
+{
+	using Task = std::function<void()>;
+
+	/// Defaults to one worker per host thread.
+	explicit ThreadPool(std::size_t thread_count = 0);
+
+	/// Waits for pending tasks, then joins the workers.
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&)                    = delete;
+	auto operator=(const ThreadPool&) -> ThreadPool& = delete;
+
+	/// Queues `task` on the workers in a round-robin fashion.
+	void submit(Task task);
+
+	/// Blocks until every submitted task has completed.
+	void wait();
+
+	[[nodiscard]] auto thread_count() const -> std::size_t { return m_threads.size(); }
+
+	private:
+	struct Worker
+	{
+		std::mutex       mutex;
+		std::deque<Task> tasks;
+	};
+
+	void work(std::size_t index);
+	auto take(std::size_t index) -> std::optional<Task>;
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread>             m_threads;
+
+	std::mutex              m_mutex;
+	std::condition_variable m_work_available;
+	std::condition_variable m_idle;
+
+	/// Tasks sitting in a deque, and tasks not yet completed, guarded by `m_mutex`
+	std::size_t m_queued   = 0;
+	std::size_t m_pending  = 0;
+	bool        m_stopping = false;
+
+	std::size_t m_next_worker = 0;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/// Paces emulation to a target instruction rate, by sleeping between slices until host time catches up with the
+/// executed instructions.
+///
+/// Pacing is computed against a fixed starting point rather than from slice to slice, so that sleep inaccuracies do not
+/// accumulate. Each sleep ends with a short spin, as the kernel wakes sleepers up late by tens of microseconds.
+struct Throttle
+{
+	using Clock = std::chrono::steady_clock;
+
+	/// Left to a spin rather than to the kernel at the end of each sleep
+	static constexpr auto spin_duration = std::chrono::microseconds(50);
+
+	/// Lagging further behind than this restarts pacing, rather than running flat out until caught up
+	static constexpr auto max_lag = std::chrono::milliseconds(100);
+
+	/// Reduces the timer slack of the calling thread, which should be the one calling `pace`.
+	explicit Throttle(double target_mhz);
+
+	/// Sleeps until the time at which `executed_ops` instructions are due.
+	void pace(std::uint64_t executed_ops);
+
+	/// Paces from `executed_ops` on as if starting now, e.g. after pausing or warping.
+	void restart(std::uint64_t executed_ops);
+
+	[[nodiscard]] auto target_mhz() const -> double { return m_target_mhz; }
+
+	private:
+	double m_target_mhz;
+
+	Clock::time_point m_start     = Clock::now();
+	std::uint64_t     m_start_ops = 0;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <smol/instruction.hpp>
+#include <smol/types.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class BranchPredictor
+{
+	NotTaken,      ///< Always predict fallthrough
+	Taken,         ///< Always predict taken
+	BackwardTaken, ///< Backward taken, forward not taken (BTFN); register targets are predicted not taken
+	Bimodal        ///< Table of 2-bit saturating counters indexed by `rip`
+};
+
+struct TimingConfig
+{
+	BranchPredictor predictor       = BranchPredictor::Bimodal;
+	std::size_t     bimodal_entries = 1024;
+
+	/// Per `doc/cpu.md`: the cost of a misprediction is of 1 cycle.
+	std::uint64_t mispredict_penalty = 1;
+
+	/// Per `doc/cpu.md`: each 16 bits of extra immediates imply +1 cycle of latency.
+	std::uint64_t extension_word_penalty = 1;
+
+	/// Register-indirect jumps (`j`, `jal`) have no target until they execute, nor do exceptions and `intret`.
+	std::uint64_t redirect_penalty = 1;
+};
+
+/// Parses a `--timing` specification: `not-taken`, `taken`, `btfn` or `bimodal[:entries]`.
+/// Throws `std::runtime_error` on invalid input.
+auto parse_timing_config(std::string_view spec) -> TimingConfig;
+
+/// Estimates how many cycles the executed instruction stream would take on the planned hardware core, following the
+/// cost model of `doc/cpu.md`: one instruction issued per cycle, plus stall cycles for extension words, branch
+/// mispredictions and control flow redirects.
+struct TimingModel
+{
+	struct ClassTiming
+	{
+		std::uint64_t instructions = 0;
+		std::uint64_t cycles       = 0;
+	};
+
+	struct Stalls
+	{
+		std::uint64_t extension_words = 0;
+		std::uint64_t mispredicts     = 0;
+		std::uint64_t redirects       = 0;
+	};
+
+	TimingConfig config;
+
+	std::uint64_t instructions = 0;
+	std::uint64_t cycles       = 0;
+
+	std::uint64_t branches             = 0;
+	std::uint64_t mispredicted_branches = 0;
+
+	Stalls stalls;
+
+	std::array<ClassTiming, std::size_t(insns::InstructionClass::Count)> per_class = {};
+
+	explicit TimingModel(TimingConfig config = {});
+
+	/// Accounts for an executed instruction at `rip`; `next_rip` is where execution continues.
+	void account(const insns::AnyInstruction& insn, Addr rip, Addr next_rip);
+
+	[[nodiscard]] auto ipc() const -> double;
+	[[nodiscard]] auto report() const -> std::string;
+
+	private:
+	/// Returns whether the branch at `rip` was predicted as taken, and trains the predictor with the outcome.
+	auto predict(const insns::AnyInstruction& insn, Addr rip, bool taken) -> bool;
+
+	std::vector<u8> m_counters;
+};
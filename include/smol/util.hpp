@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+
 template<class... Ts>
 struct overloaded : Ts...
 {
@@ -8,3 +12,13 @@ struct overloaded : Ts...
 
 template<class... Ts>
 overloaded(Ts...)->overloaded<Ts...>;
+
+/// Parses the whole of `value` as an unsigned integer, in any base `std::stoull` accepts. Throws
+/// `std::invalid_argument` otherwise.
+auto parse_unsigned(std::string_view value, int base = 10) -> std::uint64_t;
+
+/// Parses the whole of `value` as a finite, non-negative number. Throws `std::invalid_argument` otherwise.
+auto parse_number(std::string_view value) -> double;
+
+/// Escapes `s` for use within a JSON string.
+auto json_escape(std::string_view s) -> std::string;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <smol/memory.hpp>
+#include <smol/types.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+enum class WatchpointKind
+{
+	Write,
+	Read,
+	Access
+};
+
+struct Watchpoint
+{
+	Addr           addr;
+	std::size_t    length;
+	WatchpointKind kind;
+};
+
+struct WatchHit
+{
+	Watchpoint        watchpoint;
+	Addr              addr;
+	AccessGranularity granularity;
+	AccessKind        kind;
+
+	/// For stores, the RAM contents before and after the access; for loads, both hold the loaded value.
+	/// MMIO stores report an old value of 0, as reading it back could have side effects.
+	u32 old_value;
+	u32 new_value;
+};
+
+/// Data watchpoints, attached to an `Mmu`.
+///
+/// Watched 4 KiB pages are flagged in a table; only accesses to flagged pages take the slow path that compares them
+/// against individual watchpoints and reads the old value of stores.
+struct WatchpointSet
+{
+	static constexpr unsigned page_shift = 12;
+
+	/// Called after a matching access completed.
+	std::function<void(const WatchHit&)> on_hit;
+
+	WatchpointSet();
+
+	void add(Watchpoint watchpoint);
+
+	/// Removes watchpoints matching `watchpoint` exactly. Returns whether any was removed.
+	auto remove(const Watchpoint& watchpoint) -> bool;
+
+	[[nodiscard]] auto empty() const -> bool { return m_watchpoints.empty(); }
+
+	[[nodiscard]] auto is_watched_page(Addr addr) const -> bool { return m_watched_pages[addr >> page_shift] != 0; }
+
+	/// Slow path for accesses to watched pages.
+	void check(Addr addr, AccessGranularity granularity, AccessKind kind, u32 old_value, u32 new_value) const;
+
+	private:
+	void update_pages();
+
+	std::vector<Watchpoint> m_watchpoints;
+	std::vector<u8>         m_watched_pages;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <smol/types.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <span>
+#include <string_view>
+
+/// Interleaved PCM sample format: unsigned 8-bit or signed little-endian 16-bit samples.
+struct AudioFormat
+{
+	u32 sample_rate     = 44100;
+	u16 channels        = 1;
+	u16 bits_per_sample = 16;
+
+	[[nodiscard]] auto bytes_per_frame() const -> std::size_t { return std::size_t(channels) * bits_per_sample / 8; }
+
+	auto operator==(const AudioFormat&) const -> bool = default;
+};
+
+/// Streams PCM samples to a WAV file. The sizes in the header are only filled in once the writer is destroyed.
+struct WavWriter
+{
+	/// Throws `std::runtime_error` if `path` cannot be opened.
+	WavWriter(std::string_view path, AudioFormat format);
+	~WavWriter();
+
+	WavWriter(const WavWriter&)                    = delete;
+	auto operator=(const WavWriter&) -> WavWriter& = delete;
+
+	[[nodiscard]] auto format() const -> const AudioFormat& { return m_format; }
+
+	/// Appends whole frames in the format of the file.
+	void write(std::span<const u8> samples);
+
+	private:
+	void write_header();
+
+	std::ofstream m_file;
+	AudioFormat   m_format;
+	std::size_t   m_data_size = 0;
+};
@@ -2,6 +2,7 @@ from .entities import *
 from .label import *
 from .register import *
 
+import os
 import sys
 from typing import Any, List, Optional, Iterable
 
@@ -21,6 +22,9 @@ class Asm:
         self.sequences.append(seq)
         return self
 
+    def at(self, location: int, contents: Iterable[Any]):
+        self.sequences.append(Sequence(contents, location))
+
     def set_label(self, address, name):
         if name in self.labels:
             raise ValueError(
@@ -117,6 +121,20 @@ class Asm:
     def to_rom(self, rom_size: Optional[int] = None):
         sys.stdout.buffer.write(self.as_bytes(rom_size))
 
+        # Emit the label map alongside the ROM when requested, e.g. for the
+        # emulator profiler (`smolisa-emu --labels`)
+        labels_path = os.environ.get("SMOL2_LABELS")
+        if labels_path is not None:
+            self.write_labels(labels_path)
+
+    def write_labels(self, path: str):
+        """Writes one `<address> <name>` line per label, sorted by address.
+        Labels are only resolved after `as_bytes`."""
+
+        with open(path, "w") as f:
+            for name, address in sorted(self.labels.items(), key=lambda l: l[1]):
+                f.write(f"0x{address:08x} {name}\n")
+
     def _pre_pass(self):
         self.sequences = sorted(
             self.sequences,
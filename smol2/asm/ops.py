@@ -293,6 +293,22 @@ def basri(a_dst: Reg, b: int | Absolute):
     """Stores `a_dst >>> b[0:5]` to `a_dst`"""
     return InsR4I5(0b1101_0100, r=a_dst, imm=Immediate(b, False, 0))
 
+def ll32(addr: Reg, dst: Reg):
+    """Load-linked: load u32 from memory at `addr` to register `dst`, and take
+    a reservation on `addr` for the next `sc32`"""
+    return InsR4R4(0b1101_0110, a=addr, b=dst)
+
+def sc32(addr: Reg, src: Reg):
+    """Store-conditional: store `src` to memory at `addr` if it still holds
+    the value read by the `ll32` that took the reservation. The `T`-bit is set
+    to `1` on success, and to `0` otherwise"""
+    return InsR4R4(0b1101_0111, a=addr, b=src)
+
+def fence():
+    """Full memory barrier: memory accesses before the fence are visible to
+    other cores before any access after it"""
+    return RawInsU16(0b1101_1000_0000_0000)
+
 def intoff():
     """Disables interrupts"""
     return RawInsU16(0b1110_0000_0000_0000)
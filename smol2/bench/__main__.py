@@ -0,0 +1,24 @@
+"""Builds every guest benchmark ROM to `<output directory>/<name>.bin`.
+
+Usage: python3 -m smol2.bench <output directory>"""
+
+import os
+import sys
+
+from . import bf, branch, fib, memcpy, mmio
+
+roms = {
+    "fib": fib.asm,
+    "bf": bf.asm,
+    "memcpy": memcpy.asm,
+    "branch": branch.asm,
+    "mmio": mmio.asm,
+}
+
+if __name__ == "__main__":
+    output_dir = sys.argv[1]
+    os.makedirs(output_dir, exist_ok=True)
+
+    for name, asm in roms.items():
+        with open(os.path.join(output_dir, f"{name}.bin"), "wb") as f:
+            f.write(asm.as_bytes())
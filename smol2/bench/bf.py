@@ -0,0 +1,6 @@
+# The Brainfuck interpreter example, running a never ending program that writes
+# to the framebuffer: indirect jump and byte load heavy
+from smol2.examples.bfi import asm
+
+if __name__ == "__main__":
+    asm.to_rom()
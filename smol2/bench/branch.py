@@ -0,0 +1,51 @@
+from smol2.asm import *
+
+# Conditional branches on xorshift32 output bits, which no predictor can learn,
+# mixed with a short counted loop
+
+asm = Asm()
+
+reg_state = r0
+reg_tmp = r1
+reg_taken_a = r2
+reg_taken_b = r3
+reg_count = r4
+
+def xorshift_step(op, shift):
+    return [
+        lr(reg_state, reg_tmp),
+        op(reg_tmp, shift),
+        bxor(reg_state, reg_tmp),
+    ]
+
+asm.at(0x0000, [
+    lsiw(reg_state, 0x1234),
+
+    Label("again"),
+    *xorshift_step(bsli, 13),
+    *xorshift_step(bsri_tlsb, 17),
+    *xorshift_step(bsli, 5),
+
+    lr(reg_state, reg_tmp),
+    bsri_tlsb(reg_tmp, 7),
+    c_ji("skip_a"),
+    iaddsi(reg_taken_a, 1),
+    Label("skip_a"),
+
+    lr(reg_state, reg_tmp),
+    bsri_tlsb(reg_tmp, 11),
+    c_ji("skip_b"),
+    iaddsi(reg_taken_b, 1),
+    Label("skip_b"),
+
+    lsi(reg_count, 3),
+    Label("count"),
+    iaddsi_tnz(reg_count, -1),
+    c_ji("count"),
+
+    te(reg_state, reg_state),
+    c_ji("again"),
+])
+
+if __name__ == "__main__":
+    asm.to_rom()
@@ -0,0 +1,49 @@
+from smol2.asm import *
+
+# Recursive fib(n), recomputed forever: call/return and stack heavy
+
+asm = Asm()
+
+reg_n = r0
+reg_result = r1
+reg_tmp = r2
+reg_fib = r10
+
+n = 20
+
+asm.at(0x0000, [
+    lsiw(rps, 0x8000),
+    lsiw(reg_fib, Absolute("fib")),
+
+    Label("again"),
+    lsiw(reg_n, n),
+    jal(reg_fib, rret),
+    te(reg_n, reg_n),
+    c_ji("again"),
+
+    # reg_result = fib(reg_n), clobbers reg_n and reg_tmp
+    Label("fib"),
+    tltsi(reg_n, 2),
+    c_lr(reg_n, reg_result),
+    c_j(rret),
+
+    push(rret),
+    push(reg_n),
+    iaddsi(reg_n, -1),
+    jal(reg_fib, rret),
+
+    l32(rps, reg_n),
+    push(reg_result),
+    iaddsi(reg_n, -2),
+    jal(reg_fib, rret),
+
+    l32(rps, reg_tmp),
+    iadd(reg_result, reg_tmp),
+    iaddsiw(rps, rps, 8),
+    l32(rps, rret),
+    iaddsi(rps, 4),
+    j(rret),
+])
+
+if __name__ == "__main__":
+    asm.to_rom()
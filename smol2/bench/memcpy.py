@@ -0,0 +1,45 @@
+from smol2.asm import *
+
+# Copies then fills 4KiB buffers word by word, forever
+
+asm = Asm()
+
+src_base = 0x0001_0000
+dst_base = 0x0002_0000
+word_count = 1024
+
+reg_src = r0
+reg_dst = r1
+reg_count = r2
+reg_tmp = r3
+
+asm.at(0x0000, [
+    Label("again"),
+    lsiw(reg_src, src_base),
+    lsiw(reg_dst, dst_base),
+    lsiw(reg_count, word_count),
+
+    Label("copy"),
+    l32(reg_src, reg_tmp),
+    s32(reg_dst, reg_tmp),
+    iaddsi(reg_src, 4),
+    iaddsi(reg_dst, 4),
+    iaddsi_tnz(reg_count, -1),
+    c_ji("copy"),
+
+    lsiw(reg_dst, dst_base),
+    lsiw(reg_count, word_count),
+    lsi(reg_tmp, 0x55),
+
+    Label("fill"),
+    s32(reg_dst, reg_tmp),
+    iaddsi(reg_dst, 4),
+    iaddsi_tnz(reg_count, -1),
+    c_ji("fill"),
+
+    te(reg_src, reg_src),
+    c_ji("again"),
+])
+
+if __name__ == "__main__":
+    asm.to_rom()
@@ -0,0 +1,28 @@
+from smol2.asm import *
+
+# Polls and writes a framebuffer MMIO register in a tight loop
+
+asm = Asm()
+
+reg_fb = r0
+reg_value = r1
+
+asm.at(0x0000, [
+    liprel(rpl, "Literals"),
+    pl_l32(reg_fb, 0),
+
+    Label("again"),
+    l8(reg_fb, reg_value),
+    iaddsi(reg_value, 1),
+    s8(reg_fb, reg_value),
+    l16(reg_fb, reg_value),
+    te(reg_fb, reg_fb),
+    c_ji("again"),
+
+    Align(4),
+    Label("Literals"),
+    (0xF0002000).to_bytes(4, byteorder="little"),
+])
+
+if __name__ == "__main__":
+    asm.to_rom()
@@ -0,0 +1,356 @@
+#include <smol/core.hpp>
+#include <smol/framebuffer/framebuffer.hpp>
+#include <smol/instruction.hpp>
+#include <smol/ioutil.hpp>
+#include <smol/memory.hpp>
+#include <smol/util.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <vector>
+
+namespace
+{
+constexpr std::string_view usage = R"(Syntax: ./smolisa-bench [options]
+	Runs the guest ROM and host engine microbenchmarks, and prints results as JSON
+
+Options:
+	--roms <dir>          Directory holding the guest benchmark ROMs (<name>.bin)
+	--instructions <n>    Instructions executed per guest benchmark (default 50000000)
+	--iterations <n>      Operations per host benchmark (default 20000000)
+	--filter <substring>  Only run benchmarks whose name contains <substring>
+	--output <path>       Write the JSON report to <path> rather than stdout
+	--framebuffer         Also benchmark FrameBuffer::update_char (opens a window)
+)";
+
+/// Guest benchmark ROMs, as built from `smol2/bench/`. They loop forever and are cut off after a fixed instruction count.
+constexpr std::array<std::string_view, 5> guest_roms = {"fib", "bf", "memcpy", "branch", "mmio"};
+
+using Clock = std::chrono::steady_clock;
+
+struct GuestResult
+{
+	std::string_view           name;
+	std::uint64_t              instructions = 0;
+	double                     seconds      = 0.0;
+	std::optional<std::string> error;
+};
+
+struct HostResult
+{
+	std::string_view name;
+	std::uint64_t    ops     = 0;
+	double           seconds = 0.0;
+};
+
+/// Prevents the compiler from optimizing away the computation of `value`.
+template<class T>
+void keep(const T& value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+auto seconds_since(Clock::time_point start) -> double
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+auto run_guest(std::string_view name, const std::vector<char>& rom, std::uint64_t instructions) -> GuestResult
+{
+	GuestResult result{.name = name, .instructions = 0, .seconds = 0.0, .error = std::nullopt};
+
+	Core core;
+	std::copy_n(rom.begin(), std::min(rom.size(), core.mmu.ram.size()), core.mmu.ram.begin());
+
+	// MMIO is a sink that accepts any access, so that the ROMs measure the cost of the dispatch alone
+	core.mmu.mmio_read_callback = [](Addr, AccessGranularity) -> std::pair<AccessStatus, u32> {
+		return {AccessStatus::Ok, 0};
+	};
+	core.mmu.mmio_write_callback = [](Addr, u32, AccessGranularity) { return AccessStatus::Ok; };
+
+	const auto start = Clock::now();
+
+	try
+	{
+		for (std::uint64_t i = 0; i < instructions; ++i)
+		{
+			core.execute_single();
+		}
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	result.seconds      = seconds_since(start);
+	result.instructions = core.executed_ops;
+
+	return result;
+}
+
+auto run_host(std::string_view name, std::uint64_t iterations, const std::function<void(std::uint64_t)>& body)
+	-> HostResult
+{
+	const auto start = Clock::now();
+	body(iterations);
+	return {.name = name, .ops = iterations, .seconds = seconds_since(start)};
+}
+
+/// Instruction words to decode: every halfword of the benchmark ROMs, or a fixed pseudo-random sequence without them.
+auto decode_inputs(const std::vector<std::vector<char>>& roms) -> std::vector<Instruction>
+{
+	std::vector<Instruction> ret;
+
+	for (const auto& rom : roms)
+	{
+		for (std::size_t i = 0; i + 4 <= rom.size(); i += 2)
+		{
+			Instruction insn = 0;
+			std::memcpy(&insn, rom.data() + i, sizeof(insn));
+			ret.push_back(insn);
+		}
+	}
+
+	for (u32 state = 0x1234'5678; ret.size() < 4096;)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		ret.push_back(state);
+	}
+
+	return ret;
+}
+
+auto peak_rss_kib() -> long
+{
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+auto to_json(const std::vector<GuestResult>& guest, const std::vector<HostResult>& host) -> std::string
+{
+	std::string ret = "{\n\t\"guest\": [\n";
+
+	for (std::size_t i = 0; i < guest.size(); ++i)
+	{
+		const auto& r = guest[i];
+		ret += fmt::format(
+			"\t\t{{\"name\": \"{}\", \"instructions\": {}, \"seconds\": {:.6f}, \"mips\": {:.3f}, \"ns_per_op\": {:.3f}{}}}{}\n",
+			json_escape(r.name),
+			r.instructions,
+			r.seconds,
+			1.0e-6 * double(r.instructions) / r.seconds,
+			1.0e9 * r.seconds / double(std::max<std::uint64_t>(r.instructions, 1)),
+			r.error ? fmt::format(", \"error\": \"{}\"", json_escape(*r.error)) : "",
+			i + 1 != guest.size() ? "," : "");
+	}
+
+	ret += "\t],\n\t\"host\": [\n";
+
+	for (std::size_t i = 0; i < host.size(); ++i)
+	{
+		const auto& r = host[i];
+		ret += fmt::format(
+			"\t\t{{\"name\": \"{}\", \"ops\": {}, \"seconds\": {:.6f}, \"ns_per_op\": {:.3f}}}{}\n",
+			json_escape(r.name),
+			r.ops,
+			r.seconds,
+			1.0e9 * r.seconds / double(std::max<std::uint64_t>(r.ops, 1)),
+			i + 1 != host.size() ? "," : "");
+	}
+
+	ret += fmt::format("\t],\n\t\"peak_rss_kib\": {}\n}}\n", peak_rss_kib());
+
+	return ret;
+}
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+	const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+	std::string_view                rom_dir      = SMOLISA_BENCH_ROM_DIR;
+	std::uint64_t                   instructions = 50'000'000;
+	std::uint64_t                   iterations   = 20'000'000;
+	std::string_view                filter;
+	std::optional<std::string_view> output_path;
+	bool                            bench_framebuffer = false;
+
+	for (std::size_t i = 0; i < args.size(); ++i)
+	{
+		const auto& arg = args[i];
+
+		if (arg == "-h" || arg == "--help")
+		{
+			fmt::print(stderr, "{}", usage);
+			return 1;
+		}
+
+		try
+		{
+			if (arg == "--roms" && i + 1 < args.size())
+			{
+				rom_dir = args[++i];
+			}
+			else if (arg == "--instructions" && i + 1 < args.size())
+			{
+				instructions = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--iterations" && i + 1 < args.size())
+			{
+				iterations = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--filter" && i + 1 < args.size())
+			{
+				filter = args[++i];
+			}
+			else if (arg == "--output" && i + 1 < args.size())
+			{
+				output_path = args[++i];
+			}
+			else if (arg == "--framebuffer")
+			{
+				bench_framebuffer = true;
+			}
+			else
+			{
+				fmt::print(stderr, "Unexpected argument '{}'\n{}", arg, usage);
+				return 1;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Invalid {} argument: {}\n{}", arg, e.what(), usage);
+			return 1;
+		}
+	}
+
+	if (instructions == 0 || iterations == 0)
+	{
+		fmt::print(stderr, "--instructions and --iterations must be at least 1\n");
+		return 1;
+	}
+
+	const auto selected = [&](std::string_view name) { return name.find(filter) != std::string_view::npos; };
+
+	std::vector<GuestResult>       guest;
+	std::vector<std::vector<char>> roms;
+
+	for (const auto name : guest_roms)
+	{
+		const auto path = std::filesystem::path{rom_dir} / fmt::format("{}.bin", name);
+
+		if (!std::filesystem::exists(path))
+		{
+			fmt::print(stderr, "Skipping guest benchmark '{}': {} not found\n", name, path.string());
+			continue;
+		}
+
+		roms.push_back(load_file_raw(path.string()));
+
+		if (selected(name))
+		{
+			fmt::print(stderr, "Running guest benchmark '{}'\n", name);
+			guest.push_back(run_guest(name, roms.back(), instructions));
+		}
+	}
+
+	std::vector<HostResult> host;
+
+	const auto bench_host = [&](std::string_view name, const std::function<void(std::uint64_t)>& body) {
+		if (selected(name))
+		{
+			fmt::print(stderr, "Running host benchmark '{}'\n", name);
+			host.push_back(run_host(name, iterations, body));
+		}
+	};
+
+	const auto decode_words = decode_inputs(roms);
+	bench_host("insns::decode", [&](std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i)
+		{
+			keep(insns::decode(decode_words[i % decode_words.size()]).index());
+		}
+	});
+
+	// Accesses sweep a 64KiB window, i.e. mostly hit the host L2
+	constexpr Addr window_mask = 0xFFFF;
+
+	Mmu mmu;
+
+	bench_host("Mmu::get_u8", [&](std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i)
+		{
+			keep(mmu.get_u8(Addr(i * 7) & window_mask));
+		}
+	});
+
+	bench_host("Mmu::get_u32", [&](std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i)
+		{
+			keep(mmu.get_u32(Addr(i * 4) & window_mask));
+		}
+	});
+
+	bench_host("Mmu::set_u32", [&](std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i)
+		{
+			keep(mmu.set_u32(Addr(i * 4) & window_mask, u32(i)));
+		}
+	});
+
+	bench_host("Mmu::fetch_u16", [&](std::uint64_t n) {
+		for (std::uint64_t i = 0; i < n; ++i)
+		{
+			keep(mmu.fetch_u16(Addr(i * 2) & window_mask));
+		}
+	});
+
+#ifdef SMOLISA_FRAMEBUFFER
+	if (bench_framebuffer)
+	{
+		FrameBuffer fb;
+
+		bench_host("FrameBuffer::update_char", [&](std::uint64_t n) {
+			for (std::uint64_t i = 0; i < n; ++i)
+			{
+				const std::size_t cell = i % (FrameBuffer::width * FrameBuffer::height);
+				fb.update_char(
+					{.code = char(i), .palette_front_entry = char(i & 0xF), .palette_back_entry = 0},
+					cell % FrameBuffer::width,
+					cell / FrameBuffer::width);
+			}
+		});
+	}
+#else
+	if (bench_framebuffer)
+	{
+		fmt::print(stderr, "--framebuffer requires the emulator to be built with OPTION_FRAMEBUFFER=ON\n");
+		return 1;
+	}
+#endif
+
+	const auto json = to_json(guest, host);
+
+	if (output_path)
+	{
+		std::ofstream{std::string{*output_path}} << json;
+	}
+	else
+	{
+		fmt::print("{}", json);
+	}
+}
@@ -0,0 +1,261 @@
+#include <smol/cache.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <fmt/core.h>
+#include <span>
+#include <stdexcept>
+
+namespace
+{
+auto parse_size(std::string_view value) -> std::size_t
+{
+	std::size_t multiplier = 1;
+
+	if (value.ends_with('k') || value.ends_with('K'))
+	{
+		multiplier = 1024;
+		value.remove_suffix(1);
+	}
+	else if (value.ends_with('m') || value.ends_with('M'))
+	{
+		multiplier = 1024 * 1024;
+		value.remove_suffix(1);
+	}
+
+	return std::stoul(std::string{value}) * multiplier;
+}
+} // namespace
+
+auto parse_cache_config(std::string_view spec) -> CacheConfig
+{
+	CacheConfig config;
+
+	while (!spec.empty())
+	{
+		const auto comma = spec.find(',');
+		const auto entry = spec.substr(0, comma);
+		spec             = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+
+		const auto equals = entry.find('=');
+
+		if (equals == std::string_view::npos)
+		{
+			throw std::runtime_error{fmt::format("Expected key=value, got '{}'", entry)};
+		}
+
+		const auto key   = entry.substr(0, equals);
+		const auto value = entry.substr(equals + 1);
+
+		if (key == "size")
+		{
+			config.size = parse_size(value);
+		}
+		else if (key == "ways")
+		{
+			config.associativity = parse_size(value);
+		}
+		else if (key == "line")
+		{
+			config.line_size = parse_size(value);
+		}
+		else if (key == "policy" && value == "lru")
+		{
+			config.replacement = ReplacementPolicy::Lru;
+		}
+		else if (key == "policy" && value == "fifo")
+		{
+			config.replacement = ReplacementPolicy::Fifo;
+		}
+		else if (key == "policy" && value == "random")
+		{
+			config.replacement = ReplacementPolicy::Random;
+		}
+		else
+		{
+			throw std::runtime_error{fmt::format("Unknown cache parameter '{}'", entry)};
+		}
+	}
+
+	return config;
+}
+
+auto CacheCounters::miss_rate() const -> double
+{
+	return accesses() != 0 ? double(misses) / double(accesses()) : 0.0;
+}
+
+Cache::Cache(CacheConfig config) : m_config(config)
+{
+	if (!std::has_single_bit(config.line_size) || config.line_size < 4)
+	{
+		throw std::runtime_error{"Cache line size must be a power of two of at least 4 bytes"};
+	}
+
+	if (config.associativity == 0 || config.size % (config.line_size * config.associativity) != 0)
+	{
+		throw std::runtime_error{"Cache size must be a multiple of line size * associativity"};
+	}
+
+	m_sets       = config.size / (config.line_size * config.associativity);
+	m_line_shift = std::countr_zero(config.line_size);
+
+	if (!std::has_single_bit(m_sets))
+	{
+		throw std::runtime_error{"Cache set count must be a power of two"};
+	}
+
+	m_lines.resize(m_sets * config.associativity);
+}
+
+auto Cache::victim(std::size_t set) -> Line&
+{
+	const auto ways = std::span{m_lines}.subspan(set * m_config.associativity, m_config.associativity);
+
+	if (const auto it = std::find_if(ways.begin(), ways.end(), [](const Line& l) { return !l.valid; });
+		it != ways.end())
+	{
+		return *it;
+	}
+
+	if (m_config.replacement == ReplacementPolicy::Random)
+	{
+		// xorshift32
+		m_rng ^= m_rng << 13;
+		m_rng ^= m_rng >> 17;
+		m_rng ^= m_rng << 5;
+		return ways[m_rng % ways.size()];
+	}
+
+	// Both LRU and FIFO evict the smallest stamp, they only differ in when the stamp is updated
+	return *std::min_element(
+		ways.begin(), ways.end(), [](const Line& a, const Line& b) { return a.stamp < b.stamp; });
+}
+
+auto Cache::access(Addr addr, bool write) -> bool
+{
+	++m_clock;
+
+	const Addr        tag  = addr >> m_line_shift;
+	const std::size_t set  = tag & (m_sets - 1);
+	const auto        ways = std::span{m_lines}.subspan(set * m_config.associativity, m_config.associativity);
+
+	for (Line& line : ways)
+	{
+		if (line.valid && line.tag == tag)
+		{
+			if (m_config.replacement == ReplacementPolicy::Lru)
+			{
+				line.stamp = m_clock;
+			}
+
+			line.dirty = line.dirty || write;
+			++m_counters.hits;
+			return true;
+		}
+	}
+
+	Line& line = victim(set);
+
+	if (line.valid && line.dirty)
+	{
+		++m_writebacks;
+	}
+
+	line = {.tag = tag, .valid = true, .dirty = write, .stamp = m_clock};
+	++m_counters.misses;
+	return false;
+}
+
+auto Cache::describe() const -> std::string
+{
+	constexpr std::array<std::string_view, 3> policy_names = {"lru", "fifo", "random"};
+
+	return fmt::format(
+		"{}B, {}-way, {}B lines, {}",
+		m_config.size,
+		m_config.associativity,
+		m_config.line_size,
+		policy_names.at(std::size_t(m_config.replacement)));
+}
+
+void CacheSimulator::access(Addr addr, AccessGranularity granularity, AccessKind kind, Addr rip)
+{
+	if (addr >= Mmu::mmio_start_address)
+	{
+		return;
+	}
+
+	auto& cache = kind == AccessKind::Fetch ? icache : dcache;
+
+	if (!cache)
+	{
+		return;
+	}
+
+	auto& region   = regions[rip - (rip % region_size)];
+	auto& counters = kind == AccessKind::Fetch ? region.fetch : region.data;
+
+	const Addr line_mask = ~Addr(cache->config().line_size - 1);
+	const Addr last      = addr + (Addr(1) << std::size_t(granularity)) - 1;
+
+	for (Addr line = addr & line_mask;; line += Addr(cache->config().line_size))
+	{
+		const bool hit = cache->access(line, kind == AccessKind::Store);
+		++(hit ? counters.hits : counters.misses);
+
+		if (line == (last & line_mask))
+		{
+			break;
+		}
+	}
+}
+
+auto CacheSimulator::report(std::size_t max_regions) const -> std::string
+{
+	std::string ret = "Cache simulation:\n";
+
+	const auto describe_cache = [&](std::string_view name, const std::optional<Cache>& cache) {
+		if (!cache)
+		{
+			return;
+		}
+
+		const auto& counters = cache->counters();
+		ret += fmt::format(
+			"  {} ({}): {} accesses, {} misses ({:.3f}%), {} writebacks\n",
+			name,
+			cache->describe(),
+			counters.accesses(),
+			counters.misses,
+			100.0 * counters.miss_rate(),
+			cache->writebacks());
+	};
+
+	describe_cache("I$", icache);
+	describe_cache("D$", dcache);
+
+	std::vector<std::pair<Addr, RegionCounters>> sorted(regions.begin(), regions.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return a.second.fetch.misses + a.second.data.misses > b.second.fetch.misses + b.second.data.misses;
+	});
+
+	ret += fmt::format("  regions by misses ({} bytes of rip each):\n", region_size);
+	ret += "    region                   I$ miss/access           D$ miss/access\n";
+
+	for (std::size_t i = 0; i < std::min(max_regions, sorted.size()); ++i)
+	{
+		const auto& [base, counters] = sorted[i];
+		ret += fmt::format(
+			"    {:#010x}..{:#010x} {:>10}/{:<10}  {:>10}/{}\n",
+			base,
+			base + region_size - 1,
+			counters.fetch.misses,
+			counters.fetch.accesses(),
+			counters.data.misses,
+			counters.data.accesses());
+	}
+
+	return ret;
+}
@@ -3,12 +3,20 @@
 #include "smol/util.hpp"
 #include <smol/core.hpp>
 
+#include <smol/coverage.hpp>
 #include <smol/instruction.hpp>
+#include <smol/profiler.hpp>
+#include <smol/timing.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <fmt/core.h>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 auto Core::fetch_instruction_u32() -> std::optional<u32>
 {
@@ -21,10 +29,13 @@ auto Core::fetch_instruction_u32() -> std::optional<u32>
 	// this shortcut simplifies things and doesn't cause issues unless we run
 	// into some odd edge cases (e.g. executing at the last word of a page).
 	// so we might need to change this behavior later on
+	//
+	// both halfwords are fetched silently, and `execute_single` accounts for the
+	// instruction once its length is known
 
 	{
 		AccessStatus fetch_state{};
-		std::tie(fetch_state, lower_word) = mmu.get_u16(rip);
+		std::tie(fetch_state, lower_word) = mmu.prefetch_u16(rip);
 
 		if (fetch_state != AccessStatus::Ok) [[unlikely]]
 		{
@@ -35,7 +46,7 @@ auto Core::fetch_instruction_u32() -> std::optional<u32>
 
 	{
 		AccessStatus fetch_state{};
-		std::tie(fetch_state, upper_word) = mmu.get_u16(rip + 2);
+		std::tie(fetch_state, upper_word) = mmu.prefetch_u16(rip + 2);
 
 		if (fetch_state != AccessStatus::Ok) [[unlikely]]
 		{
@@ -47,221 +58,366 @@ auto Core::fetch_instruction_u32() -> std::optional<u32>
 	return lower_word | (upper_word << 16U);
 }
 
-void Core::execute_single()
+namespace
 {
-	using namespace insns;
-
-	current_instruction = fetch_instruction_u32();
+template<class T>
+void check_load(Core& core, std::pair<AccessStatus, T> fetched, Word& dst, bool sext = false)
+{
+	const auto [state, value] = fetched;
 
-	if (!current_instruction.has_value())
+	if (!core.check_access_else_fault(state))
 	{
-		// fault has occurred; next execute_single will hit the fault handler
 		return;
 	}
 
-	const auto decoded_ins = insns::decode(*current_instruction);
+	if (sext)
+	{
+		dst = s32(std::make_signed_t<T>(value));
+	}
+	else
+	{
+		dst = value;
+	}
+}
+
+void check_store(Core& core, AccessStatus state) { core.check_access_else_fault(state); }
 
-	if (verbose_exec)
+using namespace insns;
+
+/// Called from an instruction handler, fires a pending interrupt so that it returns to `next_rip`.
+auto deliver_after_instruction(Core& c) -> bool
+{
+	const Addr current   = std::exchange(c.rip, c.next_rip);
+	const bool delivered = c.deliver_interrupts();
+
+	if (delivered)
 	{
-		fmt::print("{}| {}\n", debug_state(), disassemble(decoded_ins));
+		c.next_rip = c.rip;
 	}
 
-	const auto instruction_width = std::visit([&](auto x) { return x.length; }, decoded_ins);
-	next_rip                     = rip + instruction_width;
+	c.rip = current;
+	return delivered;
+}
 
-	const auto check_load = [this](auto fetched, Word& dst, bool sext = false) {
-		auto [state, value] = fetched;
+// Stateless so that it is only built once, and so that it can be shared by any number of cores
+constexpr auto handle_op = overloaded{
+	[](Core& c, L8 x) { check_load(c, c.mmu.get_u8(c.regs[x.addr]), c.regs[x.dst]); },
+	[](Core& c, L16 x) { check_load(c, c.mmu.get_u16(c.regs[x.addr]), c.regs[x.dst]); },
+	[](Core& c, L32 x) { check_load(c, c.mmu.get_u32(c.regs[x.addr]), c.regs[x.dst]); },
 
-		if (!check_access_else_fault(state))
+	[](Core& c, CLR x) {
+		if (c.t_bit)
 		{
+			c.regs[x.dst] = c.regs[x.src];
+		}
+	},
+
+	[](Core& c, L8OW x) { check_load(c, c.mmu.get_u8(c.regs[x.base_addr] + x.offset), c.regs[x.dst]); },
+	[](Core& c, L16OW x) { check_load(c, c.mmu.get_u16(c.regs[x.base_addr] + (x.offset << 1)), c.regs[x.dst]); },
+	[](Core& c, L32OW x) { check_load(c, c.mmu.get_u32(c.regs[x.base_addr] + (x.offset << 2)), c.regs[x.dst]); },
+
+	[](Core& c, LR x) { c.regs[x.dst] = c.regs[x.src]; },
+
+	[](Core& c, LS8 x) { check_load(c, c.mmu.get_u8(c.regs[x.addr]), c.regs[x.dst], true); },
+	[](Core& c, LS16 x) { check_load(c, c.mmu.get_u16(c.regs[x.addr]), c.regs[x.dst], true); },
+
+	[](Core& c, LS8OW x) { check_load(c, c.mmu.get_u8(c.regs[x.base_addr] + x.offset), c.regs[x.dst], true); },
+	[](Core& c, LS16OW x) { check_load(c, c.mmu.get_u16(c.regs[x.base_addr] + (x.offset << 1)), c.regs[x.dst], true); },
+
+	[](Core& c, L8O x) { check_load(c, c.mmu.get_u8(c.regs[x.base_addr] + x.offset), c.regs[x.dst]); },
+	[](Core& c, L16O x) { check_load(c, c.mmu.get_u16(c.regs[x.base_addr] + (x.offset << 1)), c.regs[x.dst]); },
+	[](Core& c, L32O x) { check_load(c, c.mmu.get_u32(c.regs[x.base_addr] + (x.offset << 2)), c.regs[x.dst]); },
+
+	[](Core& c, LS8O x) { check_load(c, c.mmu.get_u8(c.regs[x.base_addr] + x.offset), c.regs[x.dst], true); },
+	[](Core& c, LS16O x) { check_load(c, c.mmu.get_u16(c.regs[x.base_addr] + (x.offset << 1)), c.regs[x.dst], true); },
+
+	[](Core& c, LSI x) { c.regs[x.dst] = x.imm; },
+	[](Core& c, LSIH x) { c.regs[x.dst] = (c.regs[x.dst] & 0x00FF'FFFFU) | (x.imm << 24); },
+	[](Core& c, LSIW x) { c.regs[x.dst] = x.imm; },
+
+	[](Core& c, LIPREL x) { c.regs[x.dst] = c.rip + 2 + (x.imm << 1); },
+
+	[](Core& c, S8 x) { check_store(c, c.mmu.set_u8(c.regs[x.addr], c.regs[x.src])); },
+	[](Core& c, S16 x) { check_store(c, c.mmu.set_u16(c.regs[x.addr], c.regs[x.src])); },
+	[](Core& c, S32 x) { check_store(c, c.mmu.set_u32(c.regs[x.addr], c.regs[x.src])); },
+
+	[](Core& c, PUSH x) {
+		c.regs[RegisterId::RPS] -= 4;
+		check_store(c, c.mmu.set_u32(c.regs[RegisterId::RPS], c.regs[x.src]));
+	},
+
+	[](Core& c, S8OW x) { check_store(c, c.mmu.set_u8(c.regs[x.base_addr] + x.offset, c.regs[x.src])); },
+	[](Core& c, S16OW x) { check_store(c, c.mmu.set_u16(c.regs[x.base_addr] + (x.offset << 1), c.regs[x.src])); },
+	[](Core& c, S32OW x) { check_store(c, c.mmu.set_u32(c.regs[x.base_addr] + (x.offset << 2), c.regs[x.src])); },
+
+	[](Core& c, S8O x) { check_store(c, c.mmu.set_u8(c.regs[x.base_addr] + x.offset, c.regs[x.src])); },
+	[](Core& c, S16O x) { check_store(c, c.mmu.set_u16(c.regs[x.base_addr] + (x.offset << 1), c.regs[x.src])); },
+	[](Core& c, S32O x) { check_store(c, c.mmu.set_u32(c.regs[x.base_addr] + (x.offset << 2), c.regs[x.src])); },
+
+	[](Core& c, BRK x) {
+		if (!c.breakpoint_handler)
+		{
+			fmt::print("BRK called @{}\n", c.rip);
 			return;
 		}
 
-		if (sext)
+		if (c.breakpoint_handler(c))
 		{
-			value = std::make_signed_t<decltype(value)>(value);
-			dst   = s32(value);
+			c.next_rip = c.rip;
 		}
-		else
+	},
+
+	[](Core& c, TLTU x) { c.t_bit = c.regs[x.a] < c.regs[x.b]; },
+	[](Core& c, TLTS x) { c.t_bit = s32(c.regs[x.a]) < s32(c.regs[x.b]); },
+	[](Core& c, TGEU x) { c.t_bit = c.regs[x.a] >= c.regs[x.b]; },
+	[](Core& c, TGES x) { c.t_bit = s32(c.regs[x.a]) >= s32(c.regs[x.b]); },
+	[](Core& c, TE x) { c.t_bit = c.regs[x.a] == c.regs[x.b]; },
+	[](Core& c, TNE x) { c.t_bit = c.regs[x.a] != c.regs[x.b]; },
+	[](Core& c, TGTU x) { c.t_bit = c.regs[x.a] > c.regs[x.b]; },
+	[](Core& c, TGTS x) { c.t_bit = s32(c.regs[x.a]) > s32(c.regs[x.b]); },
+	[](Core& c, TLTSI x) { c.t_bit = s32(c.regs[x.a]) < s32(x.b); },
+	[](Core& c, TGESI x) { c.t_bit = s32(c.regs[x.a]) >= s32(x.b); },
+	/*[](Core& c, TBZ x) {
+		const auto v = c.regs[x.a]; 
+		c.t_bit = (
+			((v & 0x00'00'00'FF) == 0) ||
+			((v & 0x00'00'FF'00) == 0) ||
+			((v & 0x00'FF'00'00) == 0) ||
+			((v & 0xFF'00'00'00) == 0)
+		);
+	},*/
+	[](Core& c, TEI x) { c.t_bit = c.regs[x.a] == x.b; },
+	[](Core& c, TNEI x) { c.t_bit = c.regs[x.a] != x.b; },
+
+	[](Core& c, PLL32 x) { check_load(c, c.mmu.get_u32(c.regs[RegisterId::RPL] + (x.offset << 2)), c.regs[x.dst]); },
+
+	[](Core& c, J x) { c.next_rip = c.regs[x.target]; },
+	[](Core& c, CJ x) {
+		if (c.t_bit)
+		{
+			c.next_rip = c.regs[x.target];
+		}
+	},
+	[](Core& c, JAL x) {
+		c.regs[x.dst] = c.rip + 2;
+		c.next_rip    = c.regs[x.target];
+	},
+	[](Core& c, JALI x) {
+		c.regs[RegisterId::RRET] = c.rip + 2;
+		c.next_rip               = c.rip + 2 + (x.relative_target << 1);
+	},
+	[](Core& c, CJI x) {
+		if (c.t_bit)
+		{
+			c.next_rip = c.rip + 2 + (x.relative_target << 1);
+		}
+	},
+
+	[](Core& c, BSEXT8 x) { c.regs[x.a_dst] = s32(s8(c.regs[x.b])); },
+	[](Core& c, BSEXT16 x) { c.regs[x.a_dst] = s32(s16(c.regs[x.b])); },
+	[](Core& c, BZEXT8 x) { c.regs[x.a_dst] = u8(c.regs[x.b]); },
+	[](Core& c, BZEXT16 x) { c.regs[x.a_dst] = u16(c.regs[x.b]); },
+
+	[](Core& c, INEG x) { c.regs[x.a_dst] = -c.regs[x.b]; },
+	[](Core& c, ISUB x) { c.regs[x.a_dst] -= c.regs[x.b]; },
+	[](Core& c, IADD x) { c.regs[x.a_dst] += c.regs[x.b]; },
+	[](Core& c, IADDSI x) { c.regs[x.a_dst] = s32(c.regs[x.a_dst]) + x.b; },
+	[](Core& c, IADDSIW x) { c.regs[x.dst] = s32(c.regs[x.a]) + x.b; },
+	[](Core& c, IADDSITNZ x) {
+		const auto sum = s32(c.regs[x.a_dst]) + x.b;
+		c.regs[x.a_dst] = sum;
+		c.t_bit         = (sum != 0);
+	},
+
+	[](Core& c, BAND x) { c.regs[x.a_dst] &= c.regs[x.b]; },
+	[](Core& c, BOR x) { c.regs[x.a_dst] |= c.regs[x.b]; },
+	[](Core& c, BXOR x) { c.regs[x.a_dst] ^= c.regs[x.b]; },
+	[](Core& c, BSL x) { c.regs[x.a_dst] <<= c.regs[x.b]; },
+	[](Core& c, BSR x) { c.regs[x.a_dst] >>= c.regs[x.b]; },
+	[](Core& c, BASR x) { c.regs[x.a_dst] = s32(c.regs[x.a_dst]) >> c.regs[x.b]; },
+	[](Core& c, BSLI x) { c.regs[x.a_dst] <<= x.b; },
+	[](Core& c, BSRITLSB x) {
+		c.regs[x.a_dst] >>= x.b;
+		c.t_bit = (c.regs[x.a_dst] & 0b1) != 0;
+	},
+	[](Core& c, BASRI x) { c.regs[x.a_dst] = s32(c.regs[x.a_dst]) >> x.b; },
+
+	[](Core& c, LL32 x) {
+		const Addr addr           = c.regs[x.addr];
+		const auto [state, value] = c.mmu.get_u32(addr);
+
+		if (c.check_access_else_fault(state))
 		{
-			dst = value;
+			c.regs[x.dst] = value;
+			c.reservation = Reservation{.addr = addr, .value = value};
 		}
-	};
+	},
+	[](Core& c, SC32 x) {
+		const Addr addr        = c.regs[x.addr];
+		const auto reservation = std::exchange(c.reservation, std::nullopt);
 
-	const auto check_store = [this](auto state) {
-		check_access_else_fault(state);
-	};
+		if (!reservation || reservation->addr != addr)
+		{
+			c.t_bit = false;
+			return;
+		}
 
-	static const auto handle_op = overloaded{
-		[&](L8 x) { check_load(mmu.get_u8(regs[x.addr]), regs[x.dst]); },
-		[&](L16 x) { check_load(mmu.get_u16(regs[x.addr]), regs[x.dst]); },
-		[&](L32 x) { check_load(mmu.get_u32(regs[x.addr]), regs[x.dst]); },
+		const auto [state, exchanged] = c.mmu.compare_exchange_u32(addr, reservation->value, c.regs[x.src]);
 
-		[&](CLR x) {
-			if (t_bit)
-			{
-				regs[x.dst] = regs[x.src];
-			}
-		},
-
-		[&](L8OW x) { check_load(mmu.get_u8(regs[x.base_addr] + x.offset), regs[x.dst]); },
-		[&](L16OW x) { check_load(mmu.get_u16(regs[x.base_addr] + (x.offset << 1)), regs[x.dst]); },
-		[&](L32OW x) { check_load(mmu.get_u32(regs[x.base_addr] + (x.offset << 2)), regs[x.dst]); },
-
-		[&](LR x) { regs[x.dst] = regs[x.src]; },
-
-		[&](LS8 x) { check_load(mmu.get_u8(regs[x.addr]), regs[x.dst], true); },
-		[&](LS16 x) { check_load(mmu.get_u16(regs[x.addr]), regs[x.dst], true); },
-
-		[&](LS8OW x) { check_load(mmu.get_u8(regs[x.base_addr] + x.offset), regs[x.dst], true); },
-		[&](LS16OW x) { check_load(mmu.get_u16(regs[x.base_addr] + (x.offset << 1)), regs[x.dst], true); },
-
-		[&](L8O x) { check_load(mmu.get_u8(regs[x.base_addr] + x.offset), regs[x.dst]); },
-		[&](L16O x) { check_load(mmu.get_u16(regs[x.base_addr] + (x.offset << 1)), regs[x.dst]); },
-		[&](L32O x) { check_load(mmu.get_u32(regs[x.base_addr] + (x.offset << 2)), regs[x.dst]); },
-
-		[&](LS8O x) { check_load(mmu.get_u8(regs[x.base_addr] + x.offset), regs[x.dst], true); },
-		[&](LS16O x) { check_load(mmu.get_u16(regs[x.base_addr] + (x.offset << 1)), regs[x.dst], true); },
-
-		[&](LSI x) { regs[x.dst] = x.imm; },
-		[&](LSIH x) { regs[x.dst] = (regs[x.dst] & 0x00FF'FFFFU) | (x.imm << 24); },
-		[&](LSIW x) { regs[x.dst] = x.imm; },
-
-		[&](LIPREL x) { regs[x.dst] = rip + 2 + (x.imm << 1); },
-
-		[&](S8 x) { check_store(mmu.set_u8(regs[x.addr], regs[x.src])); },
-		[&](S16 x) { check_store(mmu.set_u16(regs[x.addr], regs[x.src])); },
-		[&](S32 x) { check_store(mmu.set_u32(regs[x.addr], regs[x.src])); },
-
-		[&](PUSH x) {
-			regs[RegisterId::RPS] -= 4;
-			check_store(mmu.set_u32(regs[RegisterId::RPS], regs[x.src]));
-		},
-
-		[&](S8OW x) { check_store(mmu.set_u8(regs[x.base_addr] + x.offset, regs[x.src])); },
-		[&](S16OW x) { check_store(mmu.set_u16(regs[x.base_addr] + (x.offset << 1), regs[x.src])); },
-		[&](S32OW x) { check_store(mmu.set_u32(regs[x.base_addr] + (x.offset << 2), regs[x.src])); },
-
-		[&](S8O x) { check_store(mmu.set_u8(regs[x.base_addr] + x.offset, regs[x.src])); },
-		[&](S16O x) { check_store(mmu.set_u16(regs[x.base_addr] + (x.offset << 1), regs[x.src])); },
-		[&](S32O x) { check_store(mmu.set_u32(regs[x.base_addr] + (x.offset << 2), regs[x.src])); },
-
-		[&](BRK x) { fmt::print("BRK called @{}\n", rip); },
-
-		[&](TLTU x) { t_bit = regs[x.a] < regs[x.b]; },
-		[&](TLTS x) { t_bit = s32(regs[x.a]) < s32(regs[x.b]); },
-		[&](TGEU x) { t_bit = regs[x.a] >= regs[x.b]; },
-		[&](TGES x) { t_bit = s32(regs[x.a]) >= s32(regs[x.b]); },
-		[&](TE x) { t_bit = regs[x.a] == regs[x.b]; },
-		[&](TNE x) { t_bit = regs[x.a] != regs[x.b]; },
-		[&](TGTU x) { t_bit = regs[x.a] > regs[x.b]; },
-		[&](TGTS x) { t_bit = s32(regs[x.a]) > s32(regs[x.b]); },
-		[&](TLTSI x) { t_bit = s32(regs[x.a]) < s32(x.b); },
-		[&](TGESI x) { t_bit = s32(regs[x.a]) >= s32(x.b); },
-		/*[&](TBZ x) {
-			const auto v = regs[x.a]; 
-			t_bit = (
-				((v & 0x00'00'00'FF) == 0) ||
-				((v & 0x00'00'FF'00) == 0) ||
-				((v & 0x00'FF'00'00) == 0) ||
-				((v & 0xFF'00'00'00) == 0)
-			);
-		},*/
-		[&](TEI x) { t_bit = regs[x.a] == x.b; },
-		[&](TNEI x) { t_bit = regs[x.a] != x.b; },
-
-		[&](PLL32 x) { check_load(mmu.get_u32(regs[RegisterId::RPL] + (x.offset << 2)), regs[x.dst]); },
-
-		[&](J x) { next_rip = regs[x.target]; },
-		[&](CJ x) {
-			if (t_bit)
-			{
-				next_rip = regs[x.target];
-			}
-		},
-		[&](JAL x) {
-			regs[x.dst] = rip + 2;
-			next_rip    = regs[x.target];
-		},
-		[&](JALI x) {
-			regs[RegisterId::RRET] = rip + 2;
-			next_rip               = rip + 2 + (x.relative_target << 1);
-		},
-		[&](CJI x) {
-			if (t_bit)
-			{
-				next_rip = rip + 2 + (x.relative_target << 1);
-			}
-		},
-
-		[&](BSEXT8 x) { regs[x.a_dst] = s32(s8(regs[x.b])); },
-		[&](BSEXT16 x) { regs[x.a_dst] = s32(s16(regs[x.b])); },
-		[&](BZEXT8 x) { regs[x.a_dst] = u8(regs[x.b]); },
-		[&](BZEXT16 x) { regs[x.a_dst] = u16(regs[x.b]); },
-
-		[&](INEG x) { regs[x.a_dst] = -regs[x.b]; },
-		[&](ISUB x) { regs[x.a_dst] -= regs[x.b]; },
-		[&](IADD x) { regs[x.a_dst] += regs[x.b]; },
-		[&](IADDSI x) { regs[x.a_dst] = s32(regs[x.a_dst]) + x.b; },
-		[&](IADDSIW x) { regs[x.dst] = s32(regs[x.a]) + x.b; },
-		[&](IADDSITNZ x) {
-			const auto sum = s32(regs[x.a_dst]) + x.b;
-			regs[x.a_dst]  = sum;
-			t_bit          = (sum != 0);
-		},
-
-		[&](BAND x) { regs[x.a_dst] &= regs[x.b]; },
-		[&](BOR x) { regs[x.a_dst] |= regs[x.b]; },
-		[&](BXOR x) { regs[x.a_dst] ^= regs[x.b]; },
-		[&](BSL x) { regs[x.a_dst] <<= regs[x.b]; },
-		[&](BSR x) { regs[x.a_dst] >>= regs[x.b]; },
-		[&](BASR x) { regs[x.a_dst] = s32(regs[x.a_dst]) >> regs[x.b]; },
-		[&](BSLI x) { regs[x.a_dst] <<= x.b; },
-		[&](BSRITLSB x) {
-			regs[x.a_dst] >>= x.b;
-			t_bit = (regs[x.a_dst] & 0b1) != 0;
-		},
-		[&](BASRI x) { regs[x.a_dst] = s32(regs[x.a_dst]) >> x.b; },
-
-		[&](INTOFF x) { interrupts.enabled = false; },
-		[&](INTON x) { interrupts.enabled = true; },
-		[&](INTRET x) {
-			interrupts.enabled = true;
-			rip                = interrupts.intret;
-		},
-		[&](INTWAIT x) {
-			if (!interrupts.enabled)
-			{
-				throw std::runtime_error{"Core waiting for interrupt but interrupts are disabled"};
-			}
+		if (c.check_access_else_fault(state))
+		{
+			c.t_bit = exchanged;
+		}
+	},
+	[](Core& c, FENCE x) { std::atomic_thread_fence(std::memory_order_seq_cst); },
+
+	[](Core& c, INTOFF x) { c.interrupts.enabled = false; },
+	[](Core& c, INTON x) {
+		c.interrupts.enabled = true;
+		deliver_after_instruction(c);
+	},
+	[](Core& c, INTRET x) {
+		c.interrupts.enabled = true;
+		c.next_rip           = c.interrupts.intret;
+		deliver_after_instruction(c);
+	},
+	[](Core& c, INTWAIT x) {
+		if (!c.interrupts.enabled)
+		{
+			throw std::runtime_error{"Core waiting for interrupt but interrupts are disabled"};
+		}
 
-			throw std::runtime_error{"Waiting for interrupts unimplemented"};
-		},
+		// Executes again until an interrupt fires, so that time keeps flowing for devices counting instructions. The
+		// flag is cleared first, as an interrupt fired from here already returns past this instruction
+		c.interrupts.waiting = false;
 
-		[&](Unknown) { fire_exception("Illegal instruction"); },
+		if (!deliver_after_instruction(c))
+		{
+			c.next_rip           = c.rip;
+			c.interrupts.waiting = true;
+		}
+	},
 
-		// [&](auto) { fire_exception("Unimplemented instruction"); },
-	};
+	[](Core& c, Unknown) { c.fire_exception("Illegal instruction"); },
+
+	// [](Core& c, auto) { c.fire_exception("Unimplemented instruction"); },
+};
+} // namespace
+
+void Core::execute(const insns::AnyInstruction& decoded_ins)
+{
+	const auto insn_rip = rip;
+
+	if (verbose_exec)
+	{
+		fmt::print("{}| {}\n", debug_state(), disassemble(decoded_ins));
+	}
+
+	next_rip = rip + instruction_length(decoded_ins);
+
+	std::visit([this](auto x) { handle_op(*this, x); }, decoded_ins);
+
+#ifdef SMOLISA_STATS
+	stats.count(decoded_ins, t_bit);
+#endif
+
+	if (timing != nullptr)
+	{
+		timing->account(decoded_ins, insn_rip, next_rip);
+	}
+
+	if (profiler != nullptr)
+	{
+		profiler->account(*this, decoded_ins);
+	}
+
+	if (coverage != nullptr)
+	{
+		coverage->mark(insn_rip);
+	}
 
-	std::visit(handle_op, decoded_ins);
 	rip = next_rip;
 
 	++executed_ops;
 }
 
-void Core::boot()
+void Core::execute_single()
+{
+	current_instruction = fetch_instruction_u32();
+
+	if (!current_instruction.has_value())
+	{
+		// fault has occurred; next execute_single will hit the fault handler
+		return;
+	}
+
+	const auto decoded = insns::decode(*current_instruction);
+	mmu.account_fetch(rip, insns::instruction_length(decoded));
+	execute(decoded);
+}
+
+auto Core::run(const RunLimits& limits) -> StopReason
 {
-	std::cout << debug_state_preamble() << '\n';
-	std::cout << debug_state() << '\n';
+	const auto run_start = Timer::now();
 
-	start_time = Timer::now();
+	m_stop_requested = false;
 
 	for (;;)
 	{
-		current_instruction.reset();
-		execute_single();
+		if (pending_interrupts.load(std::memory_order_relaxed) != 0)
+		{
+			deliver_interrupts();
+		}
+
+		m_slice_end = std::min<std::uint64_t>(executed_ops + slice_length - (executed_ops % slice_length), m_deadline);
+
+		if (limits.max_instructions)
+		{
+			if (executed_ops >= *limits.max_instructions)
+			{
+				return StopReason::InstructionLimit;
+			}
+
+			m_slice_end = std::min<std::uint64_t>(m_slice_end, *limits.max_instructions);
+		}
+
+		if (instruction_hook)
+		{
+			while (executed_ops < m_slice_end && !halted.load(std::memory_order_relaxed))
+			{
+				if (instruction_hook(*this))
+				{
+					m_stop_requested = true;
+					break;
+				}
+
+				current_instruction.reset();
+				execute_single();
+			}
+		}
+		else
+		{
+			while (executed_ops < m_slice_end && !halted.load(std::memory_order_relaxed))
+			{
+				current_instruction.reset();
+				execute_single();
+			}
+		}
+
+		if (halted)
+		{
+			return StopReason::Halted;
+		}
+
+		// Pending deadlines are kept, so that devices still sync once the core resumes
+		if (m_stop_requested)
+		{
+			return StopReason::Stopped;
+		}
 
-		if (executed_ops % 10000000 == 0)
+		end_slice();
+
+		if (limits.report_speed && executed_ops % 10000000 == 0)
 		{
 			const auto time_elapsed = std::chrono::duration<float>(Timer::now() - start_time).count();
 
@@ -270,25 +426,91 @@ void Core::boot()
 			fmt::print("{:.3f}s: {:9} ins, avg MHz {:.3f}\n", time_elapsed, executed_ops, avg_mhz);
 		}
 
-		if (executed_ops % 10000 == 0)
+		if (executed_ops % slice_length == 0)
 		{
 			if (keepalive)
 			{
 				keepalive();
 			}
 		}
+
+		if (limits.max_time && Timer::now() - run_start >= *limits.max_time)
+		{
+			return StopReason::TimeLimit;
+		}
+	}
+}
+
+auto Core::boot(RunLimits limits) -> StopReason
+{
+	std::cout << debug_state_preamble() << '\n';
+	std::cout << debug_state() << '\n';
+
+	start_time = Timer::now();
+
+	limits.report_speed = true;
+	return run(limits);
+}
+
+void Core::halt(Word status)
+{
+	if (!halted.exchange(true))
+	{
+		exit_status = status;
 	}
 }
 
+void Core::stop()
+{
+	m_stop_requested = true;
+	m_slice_end      = executed_ops;
+}
+
+void Core::request_deadline(std::uint64_t at)
+{
+	m_deadline  = std::min(m_deadline, at);
+	m_slice_end = std::min(m_slice_end, at);
+}
+
+void Core::end_slice()
+{
+	m_deadline = std::numeric_limits<std::uint64_t>::max();
+
+	if (sync_devices)
+	{
+		sync_devices();
+	}
+}
+
+void Core::raise_interrupt(Word id) { pending_interrupts.fetch_or(u32(1) << id, std::memory_order_release); }
+
+auto Core::deliver_interrupts() -> bool
+{
+	const u32 deliverable = pending_interrupts.load(std::memory_order_acquire)
+		& (interrupt_mask.load(std::memory_order_relaxed) | (u32(1) << exception_interrupt));
+
+	if (deliverable == 0 || !interrupts.enabled)
+	{
+		return false;
+	}
+
+	const Word id = std::countr_zero(deliverable);
+	pending_interrupts.fetch_and(~(u32(1) << id), std::memory_order_relaxed);
+	return fire_interrupt(id);
+}
+
 auto Core::fire_interrupt(Word id) -> bool
 {
 	if (!interrupts.enabled)
 	{
+		raise_interrupt(id);
 		return false;
 	}
 
 	interrupts.enabled = false;
-	interrupts.intret  = rip;
+	interrupts.intret  = interrupts.waiting ? rip + 2 : rip;
+	interrupts.waiting = false;
+	reservation.reset();
 
 	// TODO: magic constants begone
 	const Word address = (0x00001000 + id * 16);
@@ -300,11 +522,16 @@ auto Core::fire_interrupt(Word id) -> bool
 
 void Core::fire_exception(std::string_view reason)
 {
-	if (!fire_interrupt(0)) [[unlikely]]
+#ifdef SMOLISA_STATS
+	++stats.exceptions;
+#endif
+
+	if (!interrupts.enabled) [[unlikely]]
 	{
 		throw std::runtime_error{fmt::format("{} (interrupts disabled)", reason)};
 	}
 
+	fire_interrupt(exception_interrupt);
 	next_rip = rip;
 }
 
@@ -0,0 +1,164 @@
+#include <smol/coverage.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+/// 64-bit FNV-1a
+auto hash_rom(std::span<const u8> code) -> std::uint64_t
+{
+	std::uint64_t hash = 0xcbf29ce484222325;
+
+	for (const u8 byte : code)
+	{
+		hash = (hash ^ byte) * 0x100000001b3;
+	}
+
+	return hash;
+}
+} // namespace
+
+Coverage::Coverage(std::span<const u8> code) : Coverage(code.size(), hash_rom(code)) {}
+
+Coverage::Coverage(std::size_t code_size, std::uint64_t rom_hash) :
+	code_size(code_size), rom_hash(rom_hash), bits((code_size / 2 + 63) / 64), m_address_count(code_size / 2)
+{}
+
+void Coverage::merge(const Coverage& other)
+{
+	if (other.code_size != code_size || other.rom_hash != rom_hash)
+	{
+		throw std::runtime_error{fmt::format(
+			"Cannot merge coverage of a {} byte ROM (hash {:016x}) with coverage of a {} byte ROM (hash {:016x})",
+			other.code_size,
+			other.rom_hash,
+			code_size,
+			rom_hash)};
+	}
+
+	for (std::size_t i = 0; i < bits.size(); ++i)
+	{
+		bits[i] |= other.bits[i];
+	}
+}
+
+auto Coverage::load(std::string_view path) -> Coverage
+{
+	std::ifstream file{std::string{path}, std::ios::binary};
+
+	std::string   magic(file_magic.size(), '\0');
+	std::uint64_t code_size = 0;
+	std::uint64_t rom_hash  = 0;
+
+	file.read(magic.data(), std::streamsize(magic.size()));
+	file.read(reinterpret_cast<char*>(&code_size), sizeof(code_size));
+	file.read(reinterpret_cast<char*>(&rom_hash), sizeof(rom_hash));
+
+	if (!file || magic != file_magic)
+	{
+		throw std::runtime_error{fmt::format("'{}' is not a coverage file", path)};
+	}
+
+	Coverage ret(code_size, rom_hash);
+	file.read(reinterpret_cast<char*>(ret.bits.data()), std::streamsize(ret.bits.size() * sizeof(std::uint64_t)));
+
+	if (!file)
+	{
+		throw std::runtime_error{fmt::format("Coverage file '{}' is truncated", path)};
+	}
+
+	return ret;
+}
+
+void Coverage::save_merged(std::string_view path) const
+{
+	Coverage merged = *this;
+
+	if (std::filesystem::exists(path))
+	{
+		merged.merge(load(path));
+	}
+
+	std::ofstream file{std::string{path}, std::ios::binary};
+
+	if (!file)
+	{
+		throw std::runtime_error{fmt::format("Failed to open coverage output '{}'", path)};
+	}
+
+	const std::uint64_t size = code_size;
+	file.write(file_magic.data(), std::streamsize(file_magic.size()));
+	file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	file.write(reinterpret_cast<const char*>(&rom_hash), sizeof(rom_hash));
+	file.write(
+		reinterpret_cast<const char*>(merged.bits.data()),
+		std::streamsize(merged.bits.size() * sizeof(std::uint64_t)));
+}
+
+auto Coverage::report(const SymbolMap& symbols) const -> std::string
+{
+	struct LabelCoverage
+	{
+		std::string_view name;
+		Addr             begin;
+		Addr             end;
+		std::size_t      covered;
+	};
+
+	std::vector<LabelCoverage> labels;
+
+	for (std::size_t i = 0; i < symbols.symbols.size(); ++i)
+	{
+		const auto& [begin, name] = symbols.symbols[i];
+
+		if (begin >= code_size)
+		{
+			break;
+		}
+
+		Addr end = Addr(code_size);
+
+		if (i + 1 < symbols.symbols.size())
+		{
+			end = std::min<Addr>(symbols.symbols[i + 1].first, end);
+		}
+
+		std::size_t covered = 0;
+		for (Addr addr = begin & ~Addr(1); addr < end; addr += 2)
+		{
+			covered += is_covered(addr) ? 1 : 0;
+		}
+
+		labels.push_back({name, begin, end, covered});
+	}
+
+	std::stable_sort(labels.begin(), labels.end(), [](const auto& a, const auto& b) {
+		return (a.covered == 0) > (b.covered == 0);
+	});
+
+	std::size_t total = 0;
+	for (const auto word : bits)
+	{
+		total += std::popcount(word);
+	}
+
+	std::string ret = fmt::format("Coverage: {} executed instruction addresses in {} bytes of code\n", total, code_size);
+
+	for (const auto& label : labels)
+	{
+		ret += fmt::format(
+			"  {:#010x}..{:#010x} {:>8} {}{}\n",
+			label.begin,
+			label.end - 1,
+			label.covered,
+			label.name,
+			label.covered == 0 ? " (never reached)" : "");
+	}
+
+	return ret;
+}
@@ -0,0 +1,274 @@
+#include <smol/devices/audio.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void AudioDevice::attach(MmioBus& bus)
+{
+	bus.map(
+		"audio",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+auto AudioDevice::format_for(u32 control, u32 sample_rate) -> AudioFormat
+{
+	return {
+		.sample_rate     = sample_rate,
+		.channels        = u16((control & control_stereo) != 0 ? 2 : 1),
+		.bits_per_sample = u16((control & control_16bit) != 0 ? 16 : 8)};
+}
+
+auto AudioDevice::format() const -> AudioFormat { return format_for(m_control, m_sample_rate); }
+
+auto AudioDevice::queued() const -> u32 { return m_write >= m_read ? m_write - m_read : m_size - m_read + m_write; }
+
+auto AudioDevice::valid_ring(u32 control, u32 sample_rate, u32 address, u32 size) const -> bool
+{
+	const std::size_t frame_size = format_for(control, sample_rate).bytes_per_frame();
+
+	return sample_rate != 0 && size != 0 && size % frame_size == 0
+		&& std::uint64_t(address) + size <= m_core.mmu.ram.size();
+}
+
+void AudioDevice::check_watermark()
+{
+	if (queued() >= m_watermark)
+	{
+		m_status &= ~status_low;
+		return;
+	}
+
+	if ((m_status & status_low) == 0)
+	{
+		m_status |= status_low;
+
+		if (on_interrupt)
+		{
+			on_interrupt();
+		}
+	}
+}
+
+void AudioDevice::sync()
+{
+	if (!enabled())
+	{
+		return;
+	}
+
+	const AudioFormat   format     = this->format();
+	const std::size_t   frame_size = format.bytes_per_frame();
+	const double        elapsed    = std::chrono::duration<double>(Clock::now() - m_epoch).count();
+	const std::uint64_t target     = std::uint64_t(elapsed * m_sample_rate);
+
+	// Past a tenth of a second behind, e.g. after the host stalled, the backlog is dropped rather than played as silence
+	m_played = std::max(m_played, target - std::min<std::uint64_t>(target, m_sample_rate / 10));
+
+	const std::uint64_t due = target - m_played;
+
+	if (due == 0)
+	{
+		return;
+	}
+
+	const std::size_t played_bytes = std::min<std::size_t>(due, queued() / frame_size) * frame_size;
+
+	m_block.resize(due * frame_size);
+
+	// Copies out of the ring in at most two chunks, one up to its end and one from its start
+	const u8*         ring  = m_core.mmu.ram.data() + m_address;
+	const std::size_t first = std::min<std::size_t>(played_bytes, m_size - m_read);
+	std::memcpy(m_block.data(), ring + m_read, first);
+	std::memcpy(m_block.data() + first, ring, played_bytes - first);
+
+	// Silence is the midpoint of unsigned 8-bit samples, and zero for signed 16-bit samples
+	std::fill(m_block.begin() + std::ptrdiff_t(played_bytes), m_block.end(), format.bits_per_sample == 8 ? 0x80 : 0x00);
+
+	if (played_bytes < m_block.size())
+	{
+		m_status |= status_underrun;
+	}
+
+	m_read = u32((m_read + played_bytes) % m_size);
+	m_played += due;
+
+	if (on_samples)
+	{
+		on_samples(format, m_block);
+	}
+
+	check_watermark();
+}
+
+auto AudioDevice::read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case control_register: return {AccessStatus::Ok, m_control};
+	case sample_rate_register: return {AccessStatus::Ok, m_sample_rate};
+	case address_register: return {AccessStatus::Ok, m_address};
+	case size_register: return {AccessStatus::Ok, m_size};
+	case write_register: return {AccessStatus::Ok, m_write};
+	case read_register: return {AccessStatus::Ok, m_read};
+	case watermark_register: return {AccessStatus::Ok, m_watermark};
+	case status_register: return {AccessStatus::Ok, m_status};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto AudioDevice::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	// The ring and its format cannot change under the host while it plays
+	const bool configuration = offset == sample_rate_register || offset == address_register || offset == size_register;
+
+	if (configuration && enabled())
+	{
+		return AccessStatus::ErrorMmioPeripheralError;
+	}
+
+	switch (offset)
+	{
+	case control_register:
+	{
+		const bool was_enabled = enabled();
+		const u32  control     = data & (control_enable | control_16bit | control_stereo);
+
+		if ((control & control_enable) != 0 && !was_enabled)
+		{
+			if (!valid_ring(control, m_sample_rate, m_address, m_size))
+			{
+				return AccessStatus::ErrorMmioPeripheralError;
+			}
+
+			m_read   = 0;
+			m_write  = 0;
+			m_played = 0;
+			m_status = 0;
+			m_epoch  = Clock::now();
+		}
+		else if ((control & control_enable) != 0 && (control & ~control_enable) != (m_control & ~control_enable))
+		{
+			// Reinterpreting queued bytes in another format mid-stream would desynchronize frames
+			return AccessStatus::ErrorMmioPeripheralError;
+		}
+
+		m_control = control;
+
+		if (enabled())
+		{
+			check_watermark();
+		}
+
+		return AccessStatus::Ok;
+	}
+	case sample_rate_register:
+	{
+		m_sample_rate = data;
+		return AccessStatus::Ok;
+	}
+	case address_register:
+	{
+		m_address = data;
+		return AccessStatus::Ok;
+	}
+	case size_register:
+	{
+		m_size = data;
+		return AccessStatus::Ok;
+	}
+	case write_register:
+	{
+		if (data >= m_size)
+		{
+			return AccessStatus::ErrorMmioPeripheralError;
+		}
+
+		m_write = data;
+
+		if (enabled())
+		{
+			check_watermark();
+		}
+
+		return AccessStatus::Ok;
+	}
+	case watermark_register:
+	{
+		m_watermark = data;
+
+		if (enabled())
+		{
+			check_watermark();
+		}
+
+		return AccessStatus::Ok;
+	}
+	case status_register:
+	{
+		m_status &= ~(data & status_underrun);
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
+
+void AudioDevice::save_state(StateWriter& w) const
+{
+	w.put(m_control);
+	w.put(m_sample_rate);
+	w.put(m_address);
+	w.put(m_size);
+	w.put(m_write);
+	w.put(m_read);
+	w.put(m_watermark);
+	w.put(m_status);
+}
+
+void AudioDevice::load_state(StateReader& r)
+{
+	const auto control     = r.get<u32>();
+	const auto sample_rate = r.get<u32>();
+	const auto address     = r.get<u32>();
+	const auto size        = r.get<u32>();
+	const auto write       = r.get<u32>();
+	const auto read        = r.get<u32>();
+	const auto watermark   = r.get<u32>();
+	const auto status      = r.get<u32>();
+
+	// Playback reads the ring straight out of RAM, so it must hold what enabling it through `write` guarantees
+	if ((control & control_enable) != 0)
+	{
+		const std::size_t frame_size = format_for(control, sample_rate).bytes_per_frame();
+
+		if (!valid_ring(control, sample_rate, address, size) || write >= size || read >= size || read % frame_size != 0)
+		{
+			throw std::runtime_error("Invalid audio state");
+		}
+	}
+
+	m_control     = control & (control_enable | control_16bit | control_stereo);
+	m_sample_rate = sample_rate;
+	m_address     = address;
+	m_size        = size;
+	m_write       = write;
+	m_read        = read;
+	m_watermark   = watermark;
+	m_status      = status & (status_low | status_underrun);
+
+	m_played = 0;
+	m_epoch  = Clock::now();
+}
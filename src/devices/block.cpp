@@ -0,0 +1,263 @@
+#include <smol/devices/block.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+DiskImage::DiskImage(std::string_view path) : path(path)
+{
+	int fd = open(this->path.c_str(), O_RDWR | O_CLOEXEC);
+
+	if (fd < 0 && (errno == EACCES || errno == EROFS))
+	{
+		fd        = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+		read_only = true;
+	}
+
+	struct stat info{};
+	if (fd < 0 || fstat(fd, &info) != 0)
+	{
+		const int error = errno;
+
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+
+		throw std::runtime_error{fmt::format("Failed to open disk image '{}': {}", path, std::strerror(error))};
+	}
+
+	m_size = std::size_t(info.st_size);
+
+	if (m_size != 0)
+	{
+		const int protection = read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+		void*     mapping    = mmap(nullptr, m_size, protection, MAP_SHARED, fd, 0);
+
+		if (mapping == MAP_FAILED)
+		{
+			const int error = errno;
+			close(fd);
+			throw std::runtime_error{fmt::format("Failed to map disk image '{}': {}", path, std::strerror(error))};
+		}
+
+		m_data = static_cast<u8*>(mapping);
+	}
+
+	// The mapping keeps the file alive on its own
+	close(fd);
+}
+
+DiskImage::~DiskImage()
+{
+	if (m_data != nullptr)
+	{
+		munmap(m_data, m_size);
+	}
+}
+
+void DiskImage::flush()
+{
+	if (m_data != nullptr && !read_only)
+	{
+		msync(m_data, m_size, MS_SYNC);
+	}
+}
+
+BlockDevice::BlockDevice(Core& core, std::unique_ptr<DiskImage> image) :
+	m_core(core), m_image(std::move(image)), m_worker([this] { work(); })
+{}
+
+BlockDevice::~BlockDevice()
+{
+	{
+		const std::lock_guard lock{m_mutex};
+		m_stopping = true;
+	}
+
+	m_wake.notify_one();
+	m_worker.join();
+}
+
+void BlockDevice::attach(MmioBus& bus)
+{
+	bus.map(
+		"block",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+void BlockDevice::work()
+{
+	for (;;)
+	{
+		Command command{};
+
+		{
+			std::unique_lock lock{m_mutex};
+			m_wake.wait(lock, [&] { return m_pending || m_stopping; });
+
+			if (!m_pending)
+			{
+				return;
+			}
+
+			command = *m_pending;
+			m_pending.reset();
+		}
+
+		const bool ok = execute(command);
+
+		// Releases the transferred bytes to the guest along with the status
+		m_status.store(ok ? status_done : status_error, std::memory_order_release);
+
+		if (on_interrupt)
+		{
+			on_interrupt();
+		}
+	}
+}
+
+auto BlockDevice::execute(const Command& command) -> bool
+{
+	if (command.kind == command_flush)
+	{
+		if (m_image)
+		{
+			m_image->flush();
+		}
+
+		return true;
+	}
+
+	const std::uint64_t first  = command.sector;
+	const std::uint64_t length = std::uint64_t(command.count) * sector_size;
+
+	if (first + command.count > sector_count() || command.address + length > m_core.mmu.ram.size())
+	{
+		return false;
+	}
+
+	if (length == 0)
+	{
+		return true;
+	}
+
+	u8* const disk = m_image->data() + first * sector_size;
+	u8* const ram  = m_core.mmu.ram.data() + command.address;
+
+	if (command.kind == command_read)
+	{
+		std::memcpy(ram, disk, length);
+		m_core.mmu.mark_dirty(command.address, length);
+		return true;
+	}
+
+	if (m_image->read_only)
+	{
+		return false;
+	}
+
+	std::memcpy(disk, ram, length);
+	return true;
+}
+
+auto BlockDevice::read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case sector_register: return {AccessStatus::Ok, m_sector};
+	case address_register: return {AccessStatus::Ok, m_address};
+	case count_register: return {AccessStatus::Ok, m_count};
+	case status_register: return {AccessStatus::Ok, m_status.load(std::memory_order_acquire)};
+	case sectors_register: return {AccessStatus::Ok, sector_count()};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto BlockDevice::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	switch (offset)
+	{
+	case sector_register:
+	{
+		m_sector = data;
+		return AccessStatus::Ok;
+	}
+	case address_register:
+	{
+		m_address = data;
+		return AccessStatus::Ok;
+	}
+	case count_register:
+	{
+		m_count = data;
+		return AccessStatus::Ok;
+	}
+	case command_register:
+	{
+		if (data < command_read || data > command_flush
+			|| (m_status.load(std::memory_order_relaxed) & status_busy) != 0)
+		{
+			return AccessStatus::ErrorMmioPeripheralError;
+		}
+
+		m_status.store(status_busy, std::memory_order_relaxed);
+
+		{
+			const std::lock_guard lock{m_mutex};
+			m_pending = Command{.kind = data, .sector = m_sector, .address = m_address, .count = m_count};
+		}
+
+		m_wake.notify_one();
+		return AccessStatus::Ok;
+	}
+	case status_register:
+	{
+		// Busy is only ever cleared by the worker
+		m_status.fetch_and(~(data & (status_done | status_error)), std::memory_order_relaxed);
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
+
+void BlockDevice::save_state(StateWriter& w)
+{
+	while ((m_status.load(std::memory_order_acquire) & status_busy) != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	w.put(m_sector);
+	w.put(m_address);
+	w.put(m_count);
+	w.put(m_status.load(std::memory_order_relaxed));
+}
+
+void BlockDevice::load_state(StateReader& r)
+{
+	m_sector  = r.get<u32>();
+	m_address = r.get<u32>();
+	m_count   = r.get<u32>();
+
+	// No command is in flight after a restore, and a stale busy bit would reject every further one
+	m_status.store(r.get<u32>() & ~status_busy, std::memory_order_relaxed);
+}
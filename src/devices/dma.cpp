@@ -0,0 +1,252 @@
+#include <smol/devices/dma.hpp>
+
+#include <cstring>
+
+void DmaController::attach(MmioBus& bus)
+{
+	m_bus = &bus;
+
+	bus.map(
+		"dma",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+auto DmaController::is_valid_range(Addr addr, std::uint64_t length) const -> bool
+{
+	const std::uint64_t end = std::uint64_t(addr) + length;
+
+	if (end <= m_core.mmu.ram.size())
+	{
+		return true;
+	}
+
+	// Transfers touching these registers would reenter the engine mid-transfer
+	const std::uint64_t own_begin = Mmu::mmio_start_address + mmio_address;
+	const std::uint64_t own_end   = own_begin + mmio_size;
+
+	return m_core.mmu.is_mmio(addr) && end <= Mmu::address_space_size && (end <= own_begin || addr >= own_end);
+}
+
+auto DmaController::load_u8(Addr addr) -> std::pair<AccessStatus, u8>
+{
+	if (!m_core.mmu.is_mmio(addr))
+	{
+		return {AccessStatus::Ok, m_core.mmu.ram[addr]};
+	}
+
+	const auto [status, data] = m_bus->read(Mmu::mmio_address(addr), AccessGranularity::U8);
+	return {status, u8(data)};
+}
+
+auto DmaController::store_u8(Addr addr, u8 value) -> AccessStatus
+{
+	if (!m_core.mmu.is_mmio(addr))
+	{
+		m_core.mmu.ram[addr] = value;
+		m_core.mmu.mark_dirty(addr, 1);
+		return AccessStatus::Ok;
+	}
+
+	return m_bus->write(Mmu::mmio_address(addr), value, AccessGranularity::U8);
+}
+
+auto DmaController::copy(Addr source, Addr destination, u32 length) -> bool
+{
+	if (!m_core.mmu.is_mmio(source) && !m_core.mmu.is_mmio(destination))
+	{
+		std::memmove(&m_core.mmu.ram[destination], &m_core.mmu.ram[source], length);
+		m_core.mmu.mark_dirty(destination, length);
+		return true;
+	}
+
+	for (u32 i = 0; i < length; ++i)
+	{
+		const auto [status, data] = load_u8(source + i);
+
+		if (status != AccessStatus::Ok || store_u8(destination + i, data) != AccessStatus::Ok)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+auto DmaController::fill(Addr destination, u32 length, u8 value) -> bool
+{
+	if (!m_core.mmu.is_mmio(destination))
+	{
+		std::memset(&m_core.mmu.ram[destination], value, length);
+		m_core.mmu.mark_dirty(destination, length);
+		return true;
+	}
+
+	for (u32 i = 0; i < length; ++i)
+	{
+		if (store_u8(destination + i, value) != AccessStatus::Ok)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+auto DmaController::transfer() -> bool
+{
+	switch (m_control & mode_mask)
+	{
+	case mode_copy:
+	{
+		return is_valid_range(m_source, m_length) && is_valid_range(m_destination, m_length)
+			&& copy(m_source, m_destination, m_length);
+	}
+	case mode_fill:
+	{
+		return is_valid_range(m_destination, m_length) && fill(m_destination, m_length, u8(m_fill));
+	}
+	case mode_stride:
+	{
+		if (m_length == 0)
+		{
+			return true;
+		}
+
+		// Blocks are laid out in increasing address order, so checking the extent covers every block
+		const std::uint64_t source_extent      = std::uint64_t(m_length - 1) * m_source_stride + m_block_size;
+		const std::uint64_t destination_extent = std::uint64_t(m_length - 1) * m_destination_stride + m_block_size;
+
+		if (!is_valid_range(m_source, source_extent) || !is_valid_range(m_destination, destination_extent))
+		{
+			return false;
+		}
+
+		for (u32 i = 0; i < m_length; ++i)
+		{
+			if (!copy(m_source + i * m_source_stride, m_destination + i * m_destination_stride, m_block_size))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+	default: return false;
+	}
+}
+
+auto DmaController::read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case source_register: return {AccessStatus::Ok, m_source};
+	case destination_register: return {AccessStatus::Ok, m_destination};
+	case length_register: return {AccessStatus::Ok, m_length};
+	case control_register: return {AccessStatus::Ok, m_control};
+	case fill_register: return {AccessStatus::Ok, m_fill};
+	case block_size_register: return {AccessStatus::Ok, m_block_size};
+	case source_stride_register: return {AccessStatus::Ok, m_source_stride};
+	case destination_stride_register: return {AccessStatus::Ok, m_destination_stride};
+	case status_register: return {AccessStatus::Ok, m_status};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto DmaController::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	switch (offset)
+	{
+	case source_register:
+	{
+		m_source = data;
+		return AccessStatus::Ok;
+	}
+	case destination_register:
+	{
+		m_destination = data;
+		return AccessStatus::Ok;
+	}
+	case length_register:
+	{
+		m_length = data;
+		return AccessStatus::Ok;
+	}
+	case fill_register:
+	{
+		m_fill = data;
+		return AccessStatus::Ok;
+	}
+	case block_size_register:
+	{
+		m_block_size = data;
+		return AccessStatus::Ok;
+	}
+	case source_stride_register:
+	{
+		m_source_stride = data;
+		return AccessStatus::Ok;
+	}
+	case destination_stride_register:
+	{
+		m_destination_stride = data;
+		return AccessStatus::Ok;
+	}
+	case control_register:
+	{
+		m_control = data & (mode_mask | control_interrupt);
+		m_status  = transfer() ? status_done : status_error;
+
+		if ((m_control & control_interrupt) != 0 && on_interrupt)
+		{
+			on_interrupt();
+		}
+
+		return AccessStatus::Ok;
+	}
+	case status_register:
+	{
+		m_status &= ~data;
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
+
+void DmaController::save_state(StateWriter& w) const
+{
+	w.put(m_source);
+	w.put(m_destination);
+	w.put(m_length);
+	w.put(m_control);
+	w.put(m_fill);
+	w.put(m_block_size);
+	w.put(m_source_stride);
+	w.put(m_destination_stride);
+	w.put(m_status);
+}
+
+void DmaController::load_state(StateReader& r)
+{
+	m_source             = r.get<u32>();
+	m_destination        = r.get<u32>();
+	m_length             = r.get<u32>();
+	m_control            = r.get<u32>();
+	m_fill               = r.get<u32>();
+	m_block_size         = r.get<u32>();
+	m_source_stride      = r.get<u32>();
+	m_destination_stride = r.get<u32>();
+	m_status             = r.get<u32>();
+}
@@ -0,0 +1,53 @@
+#include <smol/devices/intc.hpp>
+
+void InterruptController::attach(MmioBus& bus)
+{
+	bus.map(
+		"intc",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+auto InterruptController::read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case pending_register: return {AccessStatus::Ok, core.pending_interrupts.load()};
+	case mask_register: return {AccessStatus::Ok, core.interrupt_mask.load()};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto InterruptController::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	constexpr u32 all = (u32(1) << Core::interrupt_count) - 1;
+
+	switch (offset)
+	{
+	case pending_register: core.pending_interrupts.fetch_and(~data); return AccessStatus::Ok;
+	case mask_register: core.interrupt_mask.store(data & all); return AccessStatus::Ok;
+	case raise_register:
+	{
+		if (data >= Core::interrupt_count)
+		{
+			return AccessStatus::ErrorMmioPeripheralError;
+		}
+
+		raise(data);
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
@@ -0,0 +1,88 @@
+#include <smol/devices/keyboard.hpp>
+
+void Keyboard::attach(MmioBus& bus)
+{
+	bus.map(
+		"keyboard",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+void Keyboard::push(u8 character)
+{
+	if (!m_queue.push(character))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	if ((m_control.load(std::memory_order_relaxed) & control_interrupt) != 0 && on_interrupt)
+	{
+		on_interrupt();
+	}
+}
+
+auto Keyboard::read(Addr offset, AccessGranularity granularity) -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case count_register: return {AccessStatus::Ok, u32(m_queue.size())};
+	case data_register:
+	{
+		const auto character = m_queue.pop();
+		return {AccessStatus::Ok, character ? event_valid | *character : 0};
+	}
+	case control_register: return {AccessStatus::Ok, m_control.load(std::memory_order_relaxed)};
+	case dropped_register: return {AccessStatus::Ok, m_dropped.load(std::memory_order_relaxed)};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto Keyboard::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	switch (offset)
+	{
+	case control_register:
+	{
+		m_control.store(data & control_interrupt, std::memory_order_relaxed);
+
+		// Events queued while the interrupt was disabled are not lost on the guest
+		if ((data & control_interrupt) != 0 && m_queue.size() != 0 && on_interrupt)
+		{
+			on_interrupt();
+		}
+
+		return AccessStatus::Ok;
+	}
+	case dropped_register:
+	{
+		m_dropped.store(0, std::memory_order_relaxed);
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
+
+void Keyboard::save_state(StateWriter& w) const
+{
+	w.put(m_control.load());
+	w.put(m_dropped.load());
+}
+
+void Keyboard::load_state(StateReader& r)
+{
+	m_control = r.get<u32>();
+	m_dropped = r.get<u32>();
+}
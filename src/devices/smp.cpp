@@ -0,0 +1,46 @@
+#include <smol/devices/smp.hpp>
+
+void SmpController::attach(MmioBus& bus)
+{
+	bus.map(
+		"smp",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+auto SmpController::read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	if (offset != core_count_register)
+	{
+		return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	return {AccessStatus::Ok, core_count};
+}
+
+auto SmpController::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (offset != ipi_register || data >= core_count)
+	{
+		return AccessStatus::ErrorMmioPeripheralError;
+	}
+
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	if (on_ipi)
+	{
+		on_ipi(data);
+	}
+
+	return AccessStatus::Ok;
+}
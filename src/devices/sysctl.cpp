@@ -0,0 +1,47 @@
+#include <smol/devices/sysctl.hpp>
+
+void SystemController::attach(MmioBus& bus)
+{
+	bus.map(
+		"sysctl",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+auto SystemController::read([[maybe_unused]] Addr offset, [[maybe_unused]] AccessGranularity granularity) const
+	-> std::pair<AccessStatus, u32>
+{
+	return {AccessStatus::ErrorMmioPeripheralError, 0};
+}
+
+auto SystemController::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (offset != exit_register && offset != warp_register)
+	{
+		return AccessStatus::ErrorMmioPeripheralError;
+	}
+
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	if (offset == warp_register)
+	{
+		if (on_warp)
+		{
+			on_warp(data != 0);
+		}
+
+		return AccessStatus::Ok;
+	}
+
+	if (on_exit)
+	{
+		on_exit(data);
+	}
+
+	return AccessStatus::Ok;
+}
@@ -0,0 +1,143 @@
+#include <smol/devices/timer.hpp>
+
+#include <algorithm>
+
+void IntervalTimer::attach(MmioBus& bus)
+{
+	bus.map(
+		"timer",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+auto IntervalTimer::ticks() const -> std::uint64_t
+{
+	if ((m_control & control_host_time) == 0)
+	{
+		return m_core.executed_ops;
+	}
+
+	const auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - m_epoch).count();
+	return std::uint64_t(elapsed * time_scale);
+}
+
+void IntervalTimer::schedule()
+{
+	if (enabled() && (m_control & control_host_time) == 0)
+	{
+		m_core.request_deadline(m_start + std::max<u32>(m_compare, 1));
+	}
+}
+
+void IntervalTimer::sync()
+{
+	if (!enabled())
+	{
+		return;
+	}
+
+	// A compare value of 0 matches after one tick, so that periodic mode always makes progress
+	const std::uint64_t period = std::max<u32>(m_compare, 1);
+	const std::uint64_t now    = ticks();
+
+	if (now - m_start >= period)
+	{
+		m_status |= status_matched;
+
+		if ((m_control & control_periodic) != 0)
+		{
+			// Missed periods collapse into a single interrupt, without drifting
+			m_start += period * ((now - m_start) / period);
+		}
+		else
+		{
+			m_stopped = now - m_start;
+			m_control &= ~control_enable;
+		}
+
+		if (on_interrupt)
+		{
+			on_interrupt();
+		}
+	}
+
+	schedule();
+}
+
+auto IntervalTimer::read(Addr offset, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case control_register: return {AccessStatus::Ok, m_control};
+	case compare_register: return {AccessStatus::Ok, m_compare};
+	case count_register: return {AccessStatus::Ok, u32(enabled() ? ticks() - m_start : m_stopped)};
+	case status_register: return {AccessStatus::Ok, m_status};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto IntervalTimer::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	switch (offset)
+	{
+	case control_register:
+	{
+		if (enabled())
+		{
+			m_stopped = ticks() - m_start;
+		}
+
+		m_control = data & (control_enable | control_periodic | control_host_time);
+		m_start   = ticks();
+		schedule();
+		return AccessStatus::Ok;
+	}
+	case compare_register:
+	{
+		m_compare = data;
+		schedule();
+		return AccessStatus::Ok;
+	}
+	case status_register:
+	{
+		m_status &= ~data;
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
+
+void IntervalTimer::save_state(StateWriter& w) const
+{
+	w.put(m_control);
+	w.put(m_compare);
+	w.put(m_status);
+	w.put(ticks() - m_start);
+	w.put(m_stopped);
+}
+
+void IntervalTimer::load_state(StateReader& r)
+{
+	m_control = r.get<u32>();
+	m_compare = r.get<u32>();
+	m_status  = r.get<u32>();
+
+	// Wraps around when host time restarted below the saved count, which the unsigned differences above handle
+	const auto elapsed = r.get<std::uint64_t>();
+	m_start            = ticks() - elapsed;
+	m_stopped          = r.get<std::uint64_t>();
+
+	schedule();
+}
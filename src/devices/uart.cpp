@@ -0,0 +1,108 @@
+#include <smol/devices/uart.hpp>
+
+void Uart::attach(MmioBus& bus)
+{
+	bus.map(
+		"uart",
+		mmio_address,
+		mmio_size,
+		[this](Addr offset, AccessGranularity granularity) { return read(offset, granularity); },
+		[this](Addr offset, u32 data, AccessGranularity granularity) { return write(offset, data, granularity); });
+}
+
+void Uart::receive(std::span<const u8> bytes)
+{
+	bool received = false;
+
+	for (const u8 byte : bytes)
+	{
+		received |= m_rx_queue.push(byte);
+	}
+
+	// A single interrupt covers the whole chunk, as the guest reads until the queue is empty anyway
+	if (received && (m_control.load(std::memory_order_relaxed) & control_interrupt) != 0 && on_interrupt)
+	{
+		on_interrupt();
+	}
+}
+
+void Uart::flush()
+{
+	if (m_tx_buffer.empty())
+	{
+		return;
+	}
+
+	if (on_transmit)
+	{
+		on_transmit(m_tx_buffer);
+	}
+
+	m_tx_buffer.clear();
+}
+
+auto Uart::read(Addr offset, AccessGranularity granularity) -> std::pair<AccessStatus, u32>
+{
+	if (granularity != AccessGranularity::U32)
+	{
+		return {AccessStatus::ErrorMmioGranularity, 0};
+	}
+
+	switch (offset)
+	{
+	case data_register:
+	{
+		const auto byte = m_rx_queue.pop();
+		return {AccessStatus::Ok, byte ? rx_valid | *byte : 0};
+	}
+	case rx_count_register: return {AccessStatus::Ok, u32(m_rx_queue.size())};
+	case control_register: return {AccessStatus::Ok, m_control.load(std::memory_order_relaxed)};
+	default: return {AccessStatus::ErrorMmioPeripheralError, 0};
+	}
+}
+
+auto Uart::write(Addr offset, u32 data, AccessGranularity granularity) -> AccessStatus
+{
+	// Byte stores are allowed for transmitting, so that guests can print without widening characters first
+	const bool byte_transmit = offset == data_register && granularity == AccessGranularity::U8;
+
+	if (granularity != AccessGranularity::U32 && !byte_transmit)
+	{
+		return AccessStatus::ErrorMmioGranularity;
+	}
+
+	switch (offset)
+	{
+	case data_register:
+	{
+		m_tx_buffer.push_back(char(data & 0xFF));
+
+		if (m_tx_buffer.size() >= tx_buffer_size)
+		{
+			flush();
+		}
+
+		return AccessStatus::Ok;
+	}
+	case control_register:
+	{
+		m_control.store(data & control_interrupt, std::memory_order_relaxed);
+
+		if ((data & control_interrupt) != 0 && m_rx_queue.size() != 0 && on_interrupt)
+		{
+			on_interrupt();
+		}
+
+		return AccessStatus::Ok;
+	}
+	default: return AccessStatus::ErrorMmioPeripheralError;
+	}
+}
+
+void Uart::save_state(StateWriter& w)
+{
+	flush();
+	w.put(m_control.load());
+}
+
+void Uart::load_state(StateReader& r) { m_control = r.get<u32>(); }
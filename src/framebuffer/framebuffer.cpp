@@ -85,7 +85,7 @@ void FrameBuffer::rebuild()
 	}
 }
 
-auto FrameBuffer::display() -> bool
+auto FrameBuffer::poll_events() -> bool
 {
 	for (sf::Event ev{}; m_window.pollEvent(ev);)
 	{
@@ -97,10 +97,30 @@ auto FrameBuffer::display() -> bool
 			return false;
 		}
 
+		case sf::Event::TextEntered:
+		{
+			if (ev.text.unicode < 0x80 && on_text_entered)
+			{
+				on_text_entered(u8(ev.text.unicode));
+			}
+
+			break;
+		}
+
 		default: break;
 		}
 	}
 
+	return true;
+}
+
+auto FrameBuffer::display() -> bool
+{
+	if (!poll_events())
+	{
+		return false;
+	}
+
 	m_window.clear();
 
 	sf::Texture texture;
@@ -265,3 +285,16 @@ auto FrameBuffer::get_byte(Addr addr) const -> std::optional<u8>
 	default: return std::nullopt;
 	}
 }
+
+void FrameBuffer::save_state(StateWriter& w) const
+{
+	w.put_bytes(m_character_data.data(), m_character_data.size());
+	w.put_bytes(m_palette_data.data(), m_palette_data.size());
+}
+
+void FrameBuffer::load_state(StateReader& r)
+{
+	r.get_bytes(m_character_data.data(), m_character_data.size());
+	r.get_bytes(m_palette_data.data(), m_palette_data.size());
+	rebuild();
+}
@@ -0,0 +1,738 @@
+#include <smol/gdbstub.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <fmt/core.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr std::size_t register_count = RegisterFile::register_count + 2;
+constexpr std::size_t rip_register   = RegisterFile::register_count;
+constexpr std::size_t t_register     = RegisterFile::register_count + 1;
+
+auto parse_hex(std::string_view s) -> std::optional<u32>
+{
+	u32 value = 0;
+
+	const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value, 16);
+
+	if (ec != std::errc{} || end != s.data() + s.size())
+	{
+		return std::nullopt;
+	}
+
+	return value;
+}
+
+auto hex_bytes(const u8* data, std::size_t size) -> std::string
+{
+	std::string ret;
+	ret.reserve(size * 2);
+
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		ret += fmt::format("{:02x}", data[i]);
+	}
+
+	return ret;
+}
+
+auto unhex_bytes(std::string_view s) -> std::optional<std::vector<u8>>
+{
+	if (s.size() % 2 != 0)
+	{
+		return std::nullopt;
+	}
+
+	std::vector<u8> ret;
+
+	for (std::size_t i = 0; i < s.size(); i += 2)
+	{
+		const auto byte = parse_hex(s.substr(i, 2));
+
+		if (!byte)
+		{
+			return std::nullopt;
+		}
+
+		ret.push_back(u8(*byte));
+	}
+
+	return ret;
+}
+
+auto hex_word(Word value) -> std::string
+{
+	const std::array<u8, 4> bytes = {u8(value), u8(value >> 8), u8(value >> 16), u8(value >> 24)};
+	return hex_bytes(bytes.data(), bytes.size());
+}
+
+auto unhex_word(std::string_view s) -> std::optional<Word>
+{
+	const auto bytes = unhex_bytes(s);
+
+	if (!bytes || bytes->size() != 4)
+	{
+		return std::nullopt;
+	}
+
+	return Word((*bytes)[0]) | (Word((*bytes)[1]) << 8) | (Word((*bytes)[2]) << 16) | (Word((*bytes)[3]) << 24);
+}
+
+/// Splits `addr,length` and similar comma separated hexadecimal pairs.
+auto parse_pair(std::string_view s, char separator = ',') -> std::optional<std::pair<u32, u32>>
+{
+	const auto split = s.find(separator);
+
+	if (split == std::string_view::npos)
+	{
+		return std::nullopt;
+	}
+
+	const auto a = parse_hex(s.substr(0, split));
+	const auto b = parse_hex(s.substr(split + 1));
+
+	if (!a || !b)
+	{
+		return std::nullopt;
+	}
+
+	return std::pair{*a, *b};
+}
+} // namespace
+
+GdbStub::GdbStub(Core& core) :
+	core(core), m_breakpoint_pages(Mmu::address_space_size >> WatchpointSet::page_shift)
+{
+	core.breakpoint_handler = [this](Core& c) {
+		if (m_ignore_brk)
+		{
+			return false;
+		}
+
+		m_stopped = true;
+		m_stop    = {};
+		c.stop();
+		return true;
+	};
+
+	// The access completes and the target stops after the instruction, as GDB expects
+	m_watchpoints.on_hit = [this](const WatchHit& hit) {
+		m_stopped         = true;
+		m_stop.watchpoint = hit.watchpoint;
+		m_stop.watch_addr = std::max(hit.addr, hit.watchpoint.addr);
+		this->core.stop();
+	};
+}
+
+GdbStub::~GdbStub()
+{
+	core.breakpoint_handler = nullptr;
+	core.instruction_hook   = nullptr;
+	core.mmu.watchpoints    = nullptr;
+
+	if (m_fd != -1)
+	{
+		close(m_fd);
+	}
+
+	if (m_listen_fd != -1)
+	{
+		close(m_listen_fd);
+	}
+
+	if (!m_unix_path.empty())
+	{
+		unlink(m_unix_path.c_str());
+	}
+}
+
+void GdbStub::accept(std::string_view endpoint)
+{
+	if (endpoint.starts_with("unix:"))
+	{
+		m_unix_path = endpoint.substr(5);
+
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+
+		if (m_unix_path.size() >= sizeof(addr.sun_path))
+		{
+			throw std::runtime_error{fmt::format("Unix socket path '{}' is too long", m_unix_path)};
+		}
+
+		std::strcpy(addr.sun_path, m_unix_path.c_str());
+		unlink(m_unix_path.c_str());
+
+		m_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (m_listen_fd == -1 || bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+		{
+			throw std::runtime_error{fmt::format("Failed to bind '{}': {}", endpoint, std::strerror(errno))};
+		}
+	}
+	else
+	{
+		u16 port = 0;
+
+		const auto [end, ec] = std::from_chars(endpoint.data(), endpoint.data() + endpoint.size(), port);
+
+		if (ec != std::errc{} || end != endpoint.data() + endpoint.size())
+		{
+			throw std::runtime_error{fmt::format("Invalid GDB endpoint '{}'", endpoint)};
+		}
+
+		sockaddr_in addr{};
+		addr.sin_family      = AF_INET;
+		addr.sin_port        = htons(port);
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		m_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+
+		const int reuse = 1;
+		setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		if (m_listen_fd == -1 || bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+		{
+			throw std::runtime_error{fmt::format("Failed to bind port {}: {}", port, std::strerror(errno))};
+		}
+	}
+
+	if (listen(m_listen_fd, 1) != 0)
+	{
+		throw std::runtime_error{fmt::format("Failed to listen on '{}': {}", endpoint, std::strerror(errno))};
+	}
+
+	fmt::print(stderr, "Waiting for GDB connection on {}\n", endpoint);
+
+	m_fd = ::accept(m_listen_fd, nullptr, nullptr);
+
+	if (m_fd == -1)
+	{
+		throw std::runtime_error{fmt::format("Failed to accept GDB connection: {}", std::strerror(errno))};
+	}
+
+	if (!endpoint.starts_with("unix:"))
+	{
+		const int nodelay = 1;
+		setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	}
+}
+
+void GdbStub::serve()
+{
+	// The target is reported as stopped by a SIGTRAP when the client attaches
+	m_stopped = true;
+
+	while (const auto packet = receive_packet())
+	{
+		if (!handle_packet(*packet))
+		{
+			break;
+		}
+	}
+}
+
+auto GdbStub::receive_packet() -> std::optional<std::string>
+{
+	for (;;)
+	{
+		char c = 0;
+
+		// Skip acks and anything else until the start of a packet
+		do
+		{
+			if (recv(m_fd, &c, 1, 0) != 1)
+			{
+				return std::nullopt;
+			}
+		} while (c != '$');
+
+		std::string data;
+
+		for (;;)
+		{
+			if (recv(m_fd, &c, 1, 0) != 1)
+			{
+				return std::nullopt;
+			}
+
+			if (c == '#')
+			{
+				break;
+			}
+
+			data += c;
+		}
+
+		std::array<char, 2> checksum_hex{};
+
+		if (recv(m_fd, checksum_hex.data(), 2, MSG_WAITALL) != 2)
+		{
+			return std::nullopt;
+		}
+
+		u8 checksum = 0;
+		for (const char d : data)
+		{
+			checksum += u8(d);
+		}
+
+		const bool valid = parse_hex({checksum_hex.data(), 2}) == checksum;
+
+		if (m_ack_enabled)
+		{
+			send(m_fd, valid ? "+" : "-", 1, 0);
+		}
+
+		if (valid)
+		{
+			return data;
+		}
+	}
+}
+
+void GdbStub::send_packet(std::string_view data)
+{
+	u8 checksum = 0;
+	for (const char c : data)
+	{
+		checksum += u8(c);
+	}
+
+	const std::string packet = fmt::format("${}#{:02x}", data, checksum);
+	send(m_fd, packet.data(), packet.size(), MSG_NOSIGNAL);
+
+	// The client acknowledges with '+', which `receive_packet` skips over
+}
+
+auto GdbStub::handle_packet(std::string_view packet) -> bool
+{
+	if (packet.empty())
+	{
+		send_packet("");
+		return true;
+	}
+
+	const char command = packet[0];
+	const auto args    = packet.substr(1);
+
+	switch (command)
+	{
+	case '?': send_packet(stop_reply()); return true;
+
+	case 'g':
+	{
+		std::string ret;
+
+		for (std::size_t i = 0; i < register_count; ++i)
+		{
+			ret += hex_word(*read_register(i));
+		}
+
+		send_packet(ret);
+		return true;
+	}
+
+	case 'G':
+	{
+		if (args.size() != register_count * 8)
+		{
+			send_packet("E01");
+			return true;
+		}
+
+		// Parse every value first, so that a malformed payload leaves all registers untouched
+		std::array<Word, register_count> values{};
+
+		for (std::size_t i = 0; i < register_count; ++i)
+		{
+			const auto value = unhex_word(args.substr(i * 8, 8));
+
+			if (!value)
+			{
+				send_packet("E01");
+				return true;
+			}
+
+			values[i] = *value;
+		}
+
+		for (std::size_t i = 0; i < register_count; ++i)
+		{
+			write_register(i, values[i]);
+		}
+
+		send_packet("OK");
+		return true;
+	}
+
+	case 'p':
+	{
+		const auto index = parse_hex(args);
+		const auto value = index ? read_register(*index) : std::nullopt;
+		send_packet(value ? hex_word(*value) : "E01");
+		return true;
+	}
+
+	case 'P':
+	{
+		const auto split = args.find('=');
+		const auto index = parse_hex(args.substr(0, split));
+		const auto value = split != std::string_view::npos ? unhex_word(args.substr(split + 1)) : std::nullopt;
+		send_packet(index && value && write_register(*index, *value) ? "OK" : "E01");
+		return true;
+	}
+
+	case 'm':
+	{
+		const auto range = parse_pair(args);
+		const auto data  = range ? read_memory(range->first, range->second) : std::nullopt;
+		send_packet(data ? hex_bytes(data->data(), data->size()) : "E01");
+		return true;
+	}
+
+	case 'M':
+	{
+		const auto colon = args.find(':');
+		const auto range = parse_pair(args.substr(0, colon));
+		const auto data  = colon != std::string_view::npos ? unhex_bytes(args.substr(colon + 1)) : std::nullopt;
+
+		if (!range || !data || data->size() != range->second)
+		{
+			send_packet("E01");
+			return true;
+		}
+
+		send_packet(write_memory(range->first, *data) ? "OK" : "E01");
+		return true;
+	}
+
+	case 'c':
+	case 's':
+	{
+		if (const auto addr = parse_hex(args); addr)
+		{
+			core.rip = *addr;
+		}
+
+		resume(command == 's');
+		send_packet(stop_reply());
+		return true;
+	}
+
+	case 'Z':
+	case 'z':
+	{
+		// Z<type>,<addr>,<kind>
+		const auto type  = args.empty() ? '\0' : args[0];
+		const auto range = args.size() > 2 ? parse_pair(args.substr(2)) : std::nullopt;
+
+		if (!range)
+		{
+			send_packet("E01");
+			return true;
+		}
+
+		const bool insert = command == 'Z';
+
+		if (type == '0')
+		{
+			send_packet((insert ? insert_breakpoint(range->first) : remove_breakpoint(range->first)) ? "OK" : "E01");
+			return true;
+		}
+
+		if (type < '2' || type > '4')
+		{
+			// Hardware breakpoints are not supported
+			send_packet("");
+			return true;
+		}
+
+		const auto kind = type == '2' ? WatchpointKind::Write
+						: type == '3' ? WatchpointKind::Read
+									  : WatchpointKind::Access;
+
+		if (insert)
+		{
+			m_watchpoints.add({range->first, range->second, kind});
+		}
+		else
+		{
+			m_watchpoints.remove({range->first, range->second, kind});
+		}
+
+		core.mmu.watchpoints = m_watchpoints.empty() ? nullptr : &m_watchpoints;
+		send_packet("OK");
+		return true;
+	}
+
+	case 'H':
+	case 'T': send_packet("OK"); return true;
+
+	case 'D':
+		send_packet("OK");
+		return false;
+
+	case 'k': return false;
+
+	case 'q':
+		if (args.starts_with("Supported"))
+		{
+			send_packet("PacketSize=4000;QStartNoAckMode+");
+		}
+		else if (args == "Attached")
+		{
+			send_packet("1");
+		}
+		else if (args == "C")
+		{
+			send_packet("QC1");
+		}
+		else if (args == "fThreadInfo")
+		{
+			send_packet("m1");
+		}
+		else if (args == "sThreadInfo")
+		{
+			send_packet("l");
+		}
+		else
+		{
+			send_packet("");
+		}
+		return true;
+
+	case 'Q':
+		if (args == "StartNoAckMode")
+		{
+			send_packet("OK");
+			m_ack_enabled = false;
+		}
+		else
+		{
+			send_packet("");
+		}
+		return true;
+
+	default: send_packet(""); return true;
+	}
+}
+
+void GdbStub::resume(bool single_step)
+{
+	m_stopped = false;
+	m_stop    = {};
+
+	if (core.halted)
+	{
+		m_stopped = true;
+		return;
+	}
+
+	// Step off the current instruction first, so that a breakpoint or `brk` at `rip` is not reported again
+	m_ignore_brk = true;
+	step();
+	m_ignore_brk = false;
+
+	if (single_step)
+	{
+		m_stopped = true;
+		return;
+	}
+
+	while (!m_stopped)
+	{
+		try
+		{
+			const auto reason = core.run(
+				{.max_instructions = core.executed_ops + poll_interval, .max_time = std::nullopt, .report_speed = false});
+
+			// Halts are reported by `stop_reply`; `brk` and watchpoints set `m_stop` themselves
+			if (reason != ::StopReason::InstructionLimit)
+			{
+				m_stopped = true;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Target stopped: {}\n", e.what());
+			m_stopped     = true;
+			m_stop.signal = 11; // SIGSEGV
+		}
+
+		if (!m_stopped && interrupt_requested())
+		{
+			m_stopped     = true;
+			m_stop.signal = 2; // SIGINT
+		}
+	}
+}
+
+void GdbStub::step()
+{
+	try
+	{
+		core.current_instruction.reset();
+		core.execute_single();
+	}
+	catch (const std::exception& e)
+	{
+		fmt::print(stderr, "Target stopped: {}\n", e.what());
+		m_stopped     = true;
+		m_stop.signal = 11; // SIGSEGV
+	}
+}
+
+auto GdbStub::interrupt_requested() -> bool
+{
+	pollfd fd{.fd = m_fd, .events = POLLIN, .revents = 0};
+
+	if (poll(&fd, 1, 0) <= 0)
+	{
+		return false;
+	}
+
+	char c = 0;
+
+	// A disconnect stops the target as well
+	return recv(m_fd, &c, 1, 0) != 1 || c == '\x03';
+}
+
+auto GdbStub::stop_reply() const -> std::string
+{
+	if (core.halted)
+	{
+		return fmt::format("W{:02x}", core.exit_status & 0xFF);
+	}
+
+	if (!m_stop.watchpoint)
+	{
+		return fmt::format("S{:02x}", m_stop.signal);
+	}
+
+	constexpr std::array<std::string_view, 3> watch_names = {"watch", "rwatch", "awatch"};
+
+	return fmt::format(
+		"T{:02x}{}:{:x};", m_stop.signal, watch_names.at(std::size_t(m_stop.watchpoint->kind)), m_stop.watch_addr);
+}
+
+auto GdbStub::read_register(std::size_t index) const -> std::optional<Word>
+{
+	if (index < RegisterFile::register_count)
+	{
+		return core.regs[RegisterId(index)];
+	}
+
+	if (index == rip_register)
+	{
+		return core.rip;
+	}
+
+	if (index == t_register)
+	{
+		return Word(core.t_bit);
+	}
+
+	return std::nullopt;
+}
+
+auto GdbStub::write_register(std::size_t index, Word value) -> bool
+{
+	if (index < RegisterFile::register_count)
+	{
+		core.regs[RegisterId(index)] = value;
+	}
+	else if (index == rip_register)
+	{
+		core.rip = value;
+	}
+	else if (index == t_register)
+	{
+		core.t_bit = value != 0;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+auto GdbStub::read_memory(Addr addr, std::size_t length) const -> std::optional<std::vector<u8>>
+{
+	if (std::uint64_t(addr) + length > core.mmu.ram.size())
+	{
+		return std::nullopt;
+	}
+
+	return std::vector<u8>(core.mmu.ram.begin() + addr, core.mmu.ram.begin() + addr + length);
+}
+
+auto GdbStub::write_memory(Addr addr, const std::vector<u8>& data) -> bool
+{
+	if (std::uint64_t(addr) + data.size() > core.mmu.ram.size())
+	{
+		return false;
+	}
+
+	std::copy(data.begin(), data.end(), core.mmu.ram.begin() + addr);
+	core.mmu.mark_dirty(addr, data.size());
+
+	return true;
+}
+
+auto GdbStub::insert_breakpoint(Addr addr) -> bool
+{
+	if ((addr & 1) != 0 || std::uint64_t(addr) + 2 > core.mmu.ram.size())
+	{
+		return false;
+	}
+
+	m_breakpoints.insert(addr);
+	m_breakpoint_pages[addr >> WatchpointSet::page_shift] = 1;
+	update_instruction_hook();
+	return true;
+}
+
+auto GdbStub::remove_breakpoint(Addr addr) -> bool
+{
+	if (m_breakpoints.erase(addr) == 0)
+	{
+		return false;
+	}
+
+	// Unflag the page unless another breakpoint remains on it
+	const Addr page_start = addr & ~((Addr(1) << WatchpointSet::page_shift) - 1);
+	const auto next       = m_breakpoints.lower_bound(page_start);
+
+	if (next == m_breakpoints.end() || (*next >> WatchpointSet::page_shift) != (addr >> WatchpointSet::page_shift))
+	{
+		m_breakpoint_pages[addr >> WatchpointSet::page_shift] = 0;
+	}
+
+	update_instruction_hook();
+	return true;
+}
+
+void GdbStub::update_instruction_hook()
+{
+	if (m_breakpoints.empty())
+	{
+		core.instruction_hook = nullptr;
+		return;
+	}
+
+	core.instruction_hook = [this](const Core& c) {
+		return m_breakpoint_pages[c.rip >> WatchpointSet::page_shift] != 0 && m_breakpoints.contains(c.rip);
+	};
+}
@@ -0,0 +1,44 @@
+#include <smol/heatmap.hpp>
+
+#include <fmt/core.h>
+#include <fstream>
+#include <stdexcept>
+
+MemoryHeatmap::MemoryHeatmap(const std::size_t& instruction_counter) :
+	pages(Mmu::system_memory_size >> page_shift), m_clock(instruction_counter)
+{}
+
+void MemoryHeatmap::dump_csv(std::string_view path) const
+{
+	std::ofstream file{std::string{path}};
+
+	if (!file)
+	{
+		throw std::runtime_error{fmt::format("Failed to open heatmap output '{}'", path)};
+	}
+
+	file << "region,address,reads,writes,fetches,first_touch,last_touch\n";
+
+	const auto write_row = [&](std::string_view region, Addr addr, const Counters& c) {
+		file << fmt::format(
+			"{},{:#010x},{},{},{},{},{}\n", region, addr, c.reads, c.writes, c.fetches, c.first_touch, c.last_touch);
+	};
+
+	for (std::size_t i = 0; i < pages.size(); ++i)
+	{
+		if (pages[i].first_touch != Counters::untouched)
+		{
+			write_row("page", Addr(i << page_shift), pages[i]);
+		}
+	}
+
+	for (const auto& [addr, counters] : mmio)
+	{
+		write_row("mmio", Mmu::mmio_start_address + addr, counters);
+	}
+
+	if (!file.flush())
+	{
+		throw std::runtime_error{fmt::format("Failed to write heatmap output '{}'", path)};
+	}
+}
@@ -0,0 +1,56 @@
+#include <smol/inputreader.hpp>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+InputReader::InputReader(std::string_view path, Handler handler) : m_handler(std::move(handler))
+{
+	const int fd = path == "-" ? dup(STDIN_FILENO) : open(std::string{path}.c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+	{
+		throw std::runtime_error{fmt::format("Failed to open input '{}': {}", path, std::strerror(errno))};
+	}
+
+	m_thread = std::thread{[this, fd] { read_loop(fd); }};
+}
+
+InputReader::~InputReader()
+{
+	m_stopping = true;
+	m_thread.join();
+}
+
+void InputReader::read_loop(int fd)
+{
+	std::array<u8, 256> buffer{};
+
+	// Polls with a timeout, so that the destructor never waits on input that may never come
+	pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+
+	while (!m_stopping)
+	{
+		if (poll(&pfd, 1, 50) <= 0)
+		{
+			continue;
+		}
+
+		const ssize_t count = read(fd, buffer.data(), buffer.size());
+
+		if (count <= 0)
+		{
+			break;
+		}
+
+		m_handler(std::span{buffer.data(), std::size_t(count)});
+	}
+
+	close(fd);
+}
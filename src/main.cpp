@@ -1,15 +1,236 @@
 #include "smol/memory.hpp"
+#include <smol/cache.hpp>
 #include <smol/core.hpp>
+#include <smol/devices/audio.hpp>
+#include <smol/devices/block.hpp>
+#include <smol/devices/dma.hpp>
+#include <smol/devices/intc.hpp>
+#include <smol/devices/keyboard.hpp>
+#include <smol/devices/smp.hpp>
+#include <smol/devices/sysctl.hpp>
+#include <smol/devices/timer.hpp>
+#include <smol/devices/uart.hpp>
+#include <smol/coverage.hpp>
+#include <smol/dirtypages.hpp>
 #include <smol/framebuffer/framebuffer.hpp>
+#include <smol/gdbstub.hpp>
+#include <smol/heatmap.hpp>
+#include <smol/inputreader.hpp>
 #include <smol/ioutil.hpp>
+#include <smol/mmio.hpp>
+#include <smol/multicore.hpp>
+#include <smol/pipeline.hpp>
+#include <smol/profiler.hpp>
+#include <smol/rewind.hpp>
+#include <smol/semihosting.hpp>
+#include <smol/snapshot.hpp>
+#include <smol/throttle.hpp>
+#include <smol/timing.hpp>
+#include <smol/util.hpp>
+#include <smol/watchpoints.hpp>
+#include <smol/wav.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <csignal>
 #include <fmt/core.h>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <vector>
 
+namespace
+{
+constexpr std::string_view usage = R"(Syntax: ./smolisa-emu [options] <ram_boot_dump|snapshot>
+	Loads a memory dump of a smolisa machine and boots it from address 0, or resumes a
+	snapshot written by --save-snapshot
+
+Options:
+	--headless      Run without the framebuffer window or speed reports, for batch runs
+	--max-instructions <n>
+	                Stop after executing <n> instructions
+	--max-time <seconds>
+	                Stop after <seconds> of wall time
+	--exit-on-brk   Halt on `brk`, with r0 as the exit status
+	--semihosting <dir>
+	                Handle `brk` as a host service request, with file access confined to <dir>;
+	                see doc/semihosting.md
+	--dump <path>   Write the final registers, stop reason and instruction count to <path>
+	--dump-memory <begin>,<length>,<path>
+	                Write the final contents of a RAM range to <path>
+	--save-snapshot <path>
+	                Write the final state of the machine to <path>, to be resumed later; see
+	                doc/snapshots.md
+	--checkpoint <prefix>
+	                Write a checkpoint to <prefix>.<n>.snap every --checkpoint-interval instructions:
+	                a full snapshot first, then incremental ones holding only the pages written since
+	                the previous checkpoint
+	--checkpoint-interval <n>
+	                Instructions between two checkpoints (default 1000000000)
+	--rewind <MiB>  Keep up to <MiB> of compressed state history, to rewind to on exit
+	--rewind-interval <n|frame>
+	                Instructions between two history entries (default 1000000), or `frame` for
+	                every frame presented in the framebuffer window
+	--rewind-to <n> On exit, rewind to instruction <n> and replay up to it, so that --dump,
+	                --dump-memory and --save-snapshot report the state there
+	--rewind-trace <n>
+	                On exit, replay the last <n> instructions before the stop (or before
+	                --rewind-to) with execution tracing. After an emulation error, the faulting
+	                instruction is traced too
+
+	--keyboard <path|->
+	                Feed the keyboard with the bytes read from <path>, or from stdin for `-`, rather
+	                than with the characters typed into the framebuffer window
+	--uart <path|-> Write the UART output to <path> rather than to stdout
+	--uart-input <path|->
+	                Feed the UART with the bytes read from <path>, or from stdin for `-`
+	--audio <path>  Write the samples played by the audio device to <path> as a WAV file
+	--disk <path>   Back the block device with the disk image at <path>, opened read-only if it
+	                cannot be written to
+	--speed <mhz>   Throttle emulation to <mhz> million instructions per second of host time
+	--warp          Start in warp mode, running flat out without presenting frames, even with
+	                --speed, until the guest leaves it by writing 0 to 0xF0001004
+	--warp-until <n>
+	                Stay in warp mode until <n> instructions were executed
+	--timer-scale <factor>
+	                Host time timer ticks per microsecond (default 1)
+	--cores <n>     Run <n> cores sharing the same RAM, each on its own host thread. Every core
+	                boots at address 0 with its index in r0. Analysis options apply to core 0.
+
+	The guest can also halt with a status code by writing it as an u32 to 0xF0001000.
+	The exit code is then the guest status, 124 if a limit was reached, or 125 on an
+	emulation error.
+
+	--stats <path>  Write execution statistics as JSON to <path> on exit and on SIGUSR1
+	                (requires a build with OPTION_STATS)
+	--timing <predictor>
+	                Estimate cycles on the planned hardware core and print a report on exit.
+	                <predictor> is one of: not-taken, taken, btfn, bimodal[:entries]
+	--pipeline      Run on the cycle-level 5-stage pipeline model and print a report on exit
+	--no-forwarding Disable EX/MEM result forwarding in the pipeline model
+	--lockstep      Check the pipeline model against the interpreter after each instruction
+	--icache <spec>, --dcache <spec>
+	                Simulate an instruction or data cache and print a report on exit.
+	                <spec> is a comma-separated list of size=<bytes>[k|m], ways=<n>, line=<bytes>
+	                and policy=lru|fifo|random, e.g. size=8k,ways=2,line=32,policy=lru
+	--cache-region <bytes>
+	                Granularity of the per-code-region cache report (default 256)
+	--profile <path>
+	                Sample rip periodically, write folded call stacks to <path> on exit (for
+	                flamegraph.pl) and print a flat per-label report
+	--profile-interval <n>
+	                Instructions between two profiler samples (default 1009)
+	--heatmap <path>
+	                Count reads, writes and fetches per 4 KiB page and per MMIO address, and
+	                write them to <path> as CSV on exit
+	--coverage <path>
+	                Record executed instruction addresses over the loaded ROM and merge them into
+	                the bitmap at <path> on exit; with --labels, print a per-label report
+	--gdb <port|unix:path>
+	                Wait for a GDB remote protocol client on a localhost TCP port or a Unix
+	                socket, and run under its control
+	--watch <addr>[,<length>][:r|w|rw]
+	                Report accesses to a guest memory range with the accessing rip and the old and
+	                new values (default length 4, writes only). May be repeated
+	--labels <path> Label map written by the assembler (`Asm.write_labels`), used to name
+	                profiled and covered addresses
+)";
+
+volatile std::sig_atomic_t stats_dump_requested = 0;
+
+struct MemoryDump
+{
+	Addr             begin;
+	std::size_t      length;
+	std::string_view path;
+};
+
+/// Parses `<begin>,<length>,<path>`.
+auto parse_memory_dump(std::string_view spec) -> MemoryDump
+{
+	const auto first  = spec.find(',');
+	const auto second = first != std::string_view::npos ? spec.find(',', first + 1) : std::string_view::npos;
+
+	if (second == std::string_view::npos)
+	{
+		throw std::runtime_error{"Expected <begin>,<length>,<path>"};
+	}
+
+	const MemoryDump ret{
+		.begin  = Addr(parse_unsigned(spec.substr(0, first), 0)),
+		.length = parse_unsigned(spec.substr(first + 1, second - first - 1), 0),
+		.path   = spec.substr(second + 1)};
+
+	if (std::uint64_t(ret.begin) + ret.length > Mmu::system_memory_size)
+	{
+		throw std::runtime_error{"Range exceeds system memory"};
+	}
+
+	return ret;
+}
+
+auto dump_state(const Core& core, std::string_view path, std::string_view stop_reason, double seconds) -> void
+{
+	std::ofstream file{std::string{path}};
+
+	if (!file)
+	{
+		throw std::runtime_error{fmt::format("Failed to open dump file '{}'", path)};
+	}
+
+	file << fmt::format("stop_reason: {}\n", stop_reason);
+	file << fmt::format("exit_status: {}\n", core.exit_status);
+	file << fmt::format("executed_ops: {}\n", core.executed_ops);
+	file << fmt::format("seconds: {:.6f}\n", seconds);
+
+	for (std::size_t i = 0; i < RegisterFile::register_count; ++i)
+	{
+		file << fmt::format("{}: {:#010x}\n", register_name(RegisterId(i)), core.regs[RegisterId(i)]);
+	}
+
+	file << fmt::format("rip: {:#010x}\n", core.rip);
+	file << fmt::format("t: {}\n", int(core.t_bit));
+}
+
+auto parse_watchpoint(std::string_view spec) -> Watchpoint
+{
+	Watchpoint ret{.addr = 0, .length = 4, .kind = WatchpointKind::Write};
+
+	if (const auto colon = spec.find(':'); colon != std::string_view::npos)
+	{
+		const auto mode = spec.substr(colon + 1);
+		spec            = spec.substr(0, colon);
+
+		if (mode == "r")
+		{
+			ret.kind = WatchpointKind::Read;
+		}
+		else if (mode == "rw")
+		{
+			ret.kind = WatchpointKind::Access;
+		}
+		else if (mode != "w")
+		{
+			throw std::runtime_error{fmt::format("Unknown watch mode '{}'", mode)};
+		}
+	}
+
+	if (const auto comma = spec.find(','); comma != std::string_view::npos)
+	{
+		ret.length = parse_unsigned(spec.substr(comma + 1), 0);
+		spec       = spec.substr(0, comma);
+	}
+
+	ret.addr = Addr(parse_unsigned(spec, 0));
+	return ret;
+}
+} // namespace
+
 std::string_view oopsie_woopsie()
 {
 	constexpr std::array<std::string_view, 4> messages = {
@@ -27,27 +248,408 @@ auto main(int argc, char** argv) -> int
 {
 	const std::vector<std::string_view> args(argv + 1, argv + argc);
 
-	if (args.size() != 1)
+	std::string_view                rom_path;
+	std::optional<std::string_view> stats_path;
+	std::optional<TimingModel>      timing;
+	bool                            use_pipeline = false;
+	bool                            lockstep     = false;
+	PipelineConfig                  pipeline_config;
+	CacheSimulator                  cache_sim;
+	std::optional<std::string_view> profile_path;
+	std::optional<std::string_view> labels_path;
+	ProfilerConfig                  profiler_config;
+	std::optional<std::string_view> heatmap_path;
+	std::optional<std::string_view> coverage_path;
+	std::optional<std::string_view> gdb_endpoint;
+	WatchpointSet                   watchpoints;
+	bool                            headless    = false;
+	bool                            exit_on_brk = false;
+	std::optional<std::string_view> semihosting_path;
+	std::size_t                     core_count  = 1;
+	double                          timer_scale = 1.0;
+	std::optional<double>           target_mhz;
+	bool                            warp        = false;
+	std::uint64_t                   warp_until  = 0;
+	std::optional<std::string_view> keyboard_path;
+	std::optional<std::string_view> audio_path;
+	std::optional<std::string_view> uart_path;
+	std::optional<std::string_view> uart_input_path;
+	std::optional<std::string_view> disk_path;
+	RunLimits                       limits;
+	std::optional<std::string_view> dump_path;
+	std::optional<MemoryDump>       memory_dump;
+	std::optional<std::string_view> save_snapshot_path;
+	std::optional<std::string_view> checkpoint_prefix;
+	std::uint64_t                   checkpoint_interval = 1'000'000'000;
+	std::optional<std::size_t>      rewind_budget;
+	std::uint64_t                   rewind_interval = 1'000'000;
+	std::optional<std::uint64_t>    rewind_to;
+	std::optional<std::uint64_t>    rewind_trace;
+
+	for (std::size_t i = 0; i < args.size(); ++i)
+	{
+		const auto& arg = args[i];
+
+		try
+		{
+			if (arg == "-h" || arg == "--help")
+			{
+				fmt::print(stderr, "{}", usage);
+				return 1;
+			}
+
+			if (arg == "--headless")
+			{
+				headless = true;
+			}
+			else if (arg == "--max-instructions" && i + 1 < args.size())
+			{
+				limits.max_instructions = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--max-time" && i + 1 < args.size())
+			{
+				limits.max_time = std::chrono::duration<double>(parse_number(args[++i]));
+			}
+			else if (arg == "--keyboard" && i + 1 < args.size())
+			{
+				keyboard_path = args[++i];
+			}
+			else if (arg == "--uart" && i + 1 < args.size())
+			{
+				uart_path = args[++i];
+			}
+			else if (arg == "--uart-input" && i + 1 < args.size())
+			{
+				uart_input_path = args[++i];
+			}
+			else if (arg == "--audio" && i + 1 < args.size())
+			{
+				audio_path = args[++i];
+			}
+			else if (arg == "--disk" && i + 1 < args.size())
+			{
+				disk_path = args[++i];
+			}
+			else if (arg == "--speed" && i + 1 < args.size())
+			{
+				target_mhz = parse_number(args[++i]);
+			}
+			else if (arg == "--warp")
+			{
+				warp = true;
+			}
+			else if (arg == "--warp-until" && i + 1 < args.size())
+			{
+				warp_until = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--timer-scale" && i + 1 < args.size())
+			{
+				timer_scale = parse_number(args[++i]);
+			}
+			else if (arg == "--cores" && i + 1 < args.size())
+			{
+				core_count = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--exit-on-brk")
+			{
+				exit_on_brk = true;
+			}
+			else if (arg == "--semihosting" && i + 1 < args.size())
+			{
+				semihosting_path = args[++i];
+			}
+			else if (arg == "--dump" && i + 1 < args.size())
+			{
+				dump_path = args[++i];
+			}
+			else if (arg == "--dump-memory" && i + 1 < args.size())
+			{
+				memory_dump = parse_memory_dump(args[++i]);
+			}
+			else if (arg == "--save-snapshot" && i + 1 < args.size())
+			{
+				save_snapshot_path = args[++i];
+			}
+			else if (arg == "--checkpoint" && i + 1 < args.size())
+			{
+				checkpoint_prefix = args[++i];
+			}
+			else if (arg == "--checkpoint-interval" && i + 1 < args.size())
+			{
+				checkpoint_interval = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--rewind" && i + 1 < args.size())
+			{
+				rewind_budget = parse_unsigned(args[++i]) * 1024 * 1024;
+			}
+			else if (arg == "--rewind-interval" && i + 1 < args.size())
+			{
+				// An interval of 0 records on every presented frame instead
+				const auto interval = args[++i];
+				rewind_interval     = interval == "frame" ? 0 : std::max<std::uint64_t>(parse_unsigned(interval), 1);
+			}
+			else if (arg == "--rewind-to" && i + 1 < args.size())
+			{
+				rewind_to = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--rewind-trace" && i + 1 < args.size())
+			{
+				rewind_trace = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--stats" && i + 1 < args.size())
+			{
+				stats_path = args[++i];
+			}
+			else if (arg == "--timing" && i + 1 < args.size())
+			{
+				timing.emplace(parse_timing_config(args[++i]));
+			}
+			else if ((arg == "--icache" || arg == "--dcache") && i + 1 < args.size())
+			{
+				(arg == "--icache" ? cache_sim.icache : cache_sim.dcache).emplace(parse_cache_config(args[++i]));
+			}
+			else if (arg == "--cache-region" && i + 1 < args.size())
+			{
+				cache_sim.region_size = parse_unsigned(args[++i]);
+
+				if (cache_sim.region_size == 0)
+				{
+					fmt::print(stderr, "--cache-region must be non-zero\n");
+					return 1;
+				}
+			}
+			else if (arg == "--profile" && i + 1 < args.size())
+			{
+				profile_path = args[++i];
+			}
+			else if (arg == "--profile-interval" && i + 1 < args.size())
+			{
+				profiler_config.interval = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--heatmap" && i + 1 < args.size())
+			{
+				heatmap_path = args[++i];
+			}
+			else if (arg == "--coverage" && i + 1 < args.size())
+			{
+				coverage_path = args[++i];
+			}
+			else if (arg == "--gdb" && i + 1 < args.size())
+			{
+				gdb_endpoint = args[++i];
+			}
+			else if (arg == "--watch" && i + 1 < args.size())
+			{
+				watchpoints.add(parse_watchpoint(args[++i]));
+			}
+			else if (arg == "--labels" && i + 1 < args.size())
+			{
+				labels_path = args[++i];
+			}
+			else if (arg == "--pipeline")
+			{
+				use_pipeline = true;
+			}
+			else if (arg == "--no-forwarding")
+			{
+				pipeline_config.forwarding = false;
+			}
+			else if (arg == "--lockstep")
+			{
+				lockstep = true;
+			}
+			else if (rom_path.empty() && !arg.starts_with("--"))
+			{
+				rom_path = arg;
+			}
+			else
+			{
+				fmt::print(stderr, "Unexpected argument '{}'\n{}", arg, usage);
+				return 1;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Invalid {} argument: {}\n{}", arg, e.what(), usage);
+			return 1;
+		}
+	}
+
+	if (rom_path.empty())
 	{
-		fmt::print(stderr, "Syntax: ./smolisa-emu <ram_boot_dump>\n");
+		fmt::print(stderr, "{}", usage);
 		return 1;
 	}
 
-	if (args[0] == "-h" || args[0] == "--help")
+	if (lockstep && !use_pipeline)
 	{
-		fmt::print(
-			stderr,
-			R"(Syntax: ./smolisa-emu <ram_boot_dump>
-	Loads a memory dump of a smolisa machine and boots it from address 0)");
+		fmt::print(stderr, "--lockstep requires --pipeline\n");
+		return 1;
+	}
+
+	if (gdb_endpoint && (use_pipeline || !watchpoints.empty()))
+	{
+		// The stub drives the interpreter itself, and manages its own watchpoints
+		fmt::print(stderr, "--gdb cannot be combined with --pipeline or --watch\n");
 		return 1;
 	}
 
-	const auto& rom_path = args[0];
+	if (core_count == 0 || (core_count > 1 && (gdb_endpoint || use_pipeline)))
+	{
+		fmt::print(stderr, "--cores must be at least 1, and cannot be combined with --gdb or --pipeline\n");
+		return 1;
+	}
 
-	const auto rom = load_file_raw(rom_path);
+	if (target_mhz && (*target_mhz <= 0.0 || core_count > 1))
+	{
+		// Only the boot core runs the per-slice host callbacks that pacing relies on
+		fmt::print(stderr, "--speed must be positive, and cannot be combined with --cores\n");
+		return 1;
+	}
+
+	if (semihosting_path && (exit_on_brk || gdb_endpoint))
+	{
+		fmt::print(stderr, "--semihosting cannot be combined with --exit-on-brk or --gdb\n");
+		return 1;
+	}
+
+	if (keyboard_path && uart_input_path && *keyboard_path == "-" && *uart_input_path == "-")
+	{
+		fmt::print(stderr, "--keyboard and --uart-input cannot both read stdin\n");
+		return 1;
+	}
+
+	const bool resume_snapshot = snapshot::is_snapshot(rom_path);
+
+	const bool save_states = resume_snapshot || save_snapshot_path || checkpoint_prefix || rewind_budget;
+
+	if (save_states && (core_count > 1 || use_pipeline || gdb_endpoint))
+	{
+		// Only the state of the interpreter and of a single core is saved
+		fmt::print(stderr, "Snapshots, checkpoints and --rewind cannot be combined with --cores, --pipeline or --gdb\n");
+		return 1;
+	}
+
+	if ((rewind_to || rewind_trace) && !rewind_budget)
+	{
+		fmt::print(stderr, "--rewind-to and --rewind-trace require --rewind\n");
+		return 1;
+	}
+
+	if (rewind_interval == 0 && headless)
+	{
+		fmt::print(stderr, "--rewind-interval frame requires the framebuffer window\n");
+		return 1;
+	}
+
+	if (resume_snapshot && coverage_path)
+	{
+		fmt::print(stderr, "--coverage requires a ROM rather than a snapshot\n");
+		return 1;
+	}
+
+#ifndef SMOLISA_STATS
+	if (stats_path)
+	{
+		fmt::print(stderr, "--stats requires the emulator to be built with OPTION_STATS=ON\n");
+		return 1;
+	}
+#else
+	if (stats_path)
+	{
+		std::signal(SIGUSR1, [](int) { stats_dump_requested = 1; });
+	}
+#endif
+
+	const auto rom = resume_snapshot ? std::vector<char>{} : load_file_raw(rom_path);
 
 	Core core;
 
+	if (timing)
+	{
+		core.timing = &*timing;
+	}
+
+	SymbolMap symbols;
+
+	if (labels_path)
+	{
+		try
+		{
+			symbols = SymbolMap::load(*labels_path);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not load labels: {}\n", e.what());
+			return 1;
+		}
+	}
+
+	std::optional<Profiler> profiler;
+
+	if (profile_path)
+	{
+		try
+		{
+			profiler.emplace(symbols, profiler_config);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not set up profiler: {}\n", e.what());
+			return 1;
+		}
+
+		core.profiler = &*profiler;
+	}
+
+	std::optional<Coverage> coverage;
+
+	if (coverage_path)
+	{
+		coverage.emplace(
+			std::span{reinterpret_cast<const u8*>(rom.data()), std::min(rom.size(), core.mmu.ram.size())});
+		core.coverage = &*coverage;
+	}
+
+	if (!watchpoints.empty())
+	{
+		watchpoints.on_hit = [&](const WatchHit& hit) {
+			constexpr std::array<std::string_view, 3> kind_names = {"fetch", "load", "store"};
+			constexpr std::array<std::string_view, 3> size_names = {"u8", "u16", "u32"};
+
+			fmt::print(
+				stderr,
+				"Watchpoint {:#010x}: {} {} at {:#010x} by rip {:#010x}: {:#x} -> {:#x}\n",
+				hit.watchpoint.addr,
+				kind_names.at(std::size_t(hit.kind)),
+				size_names.at(std::size_t(hit.granularity)),
+				hit.addr,
+				core.rip,
+				hit.old_value,
+				hit.new_value);
+		};
+
+		core.mmu.watchpoints = &watchpoints;
+	}
+
+	std::optional<MemoryHeatmap> heatmap;
+
+	if (heatmap_path)
+	{
+		heatmap.emplace(core.executed_ops);
+		core.mmu.heatmap = &*heatmap;
+	}
+
+	const bool simulate_caches = cache_sim.icache || cache_sim.dcache;
+
+	if (simulate_caches)
+	{
+		// Fetches are attributed to their own address, data accesses to the instruction performing them
+		core.mmu.access_hook = [&](Addr addr, AccessGranularity granularity, AccessKind kind) {
+			cache_sim.access(addr, granularity, kind, kind == AccessKind::Fetch ? addr : core.rip);
+		};
+	}
+
 	if (rom.size() > core.mmu.ram.size())
 	{
 		fmt::print(
@@ -70,70 +672,398 @@ auto main(int argc, char** argv) -> int
 	// Copy ROM contents to beginning of RAM
 	std::copy_n(rom.begin(), std::min(rom.size(), core.mmu.ram.size()), core.mmu.ram.begin());
 
-#ifdef SMOLISA_FRAMEBUFFER
-	fmt::print(stderr, "Preparing 80x25 standard framebuffer\n");
-	FrameBuffer fb;
-#endif
-	core.mmu.mmio_write_callback = [&](
-		[[maybe_unused]] Addr addr,
-		[[maybe_unused]] u32 data,
-		AccessGranularity granularity
-	) -> AccessStatus {
-#ifdef SMOLISA_FRAMEBUFFER
-		/*
-		// Display retired instruction count on vsync
-		if (addr == 0x0FD0)
+	MmioBus bus;
+
+	std::optional<Multicore> multicore;
+
+	SystemController sysctl;
+	sysctl.on_exit = [&](u32 status) { multicore ? multicore->halt(status) : core.halt(status); };
+
+	std::atomic<bool> guest_warp = warp;
+	sysctl.on_warp               = [&](bool enabled) { guest_warp = enabled; };
+	sysctl.attach(bus);
+
+	InterruptController intc{core};
+	intc.attach(bus);
+
+	IntervalTimer timer{core};
+	timer.time_scale   = timer_scale;
+	timer.on_interrupt = [&] { intc.raise(IntervalTimer::interrupt_id); };
+	timer.attach(bus);
+
+	// Set while replaying after a rewind, to drop output that was already played
+	bool replaying = false;
+
+	std::optional<WavWriter> wav;
+
+	AudioDevice audio{core};
+	audio.on_interrupt = [&] { intc.raise(AudioDevice::interrupt_id); };
+	audio.on_samples   = [&](const AudioFormat& format, std::span<const u8> samples) {
+		if (!audio_path || replaying)
 		{
-			fmt::print(stderr, ">>> retired {} instructions\n", core.retired_instructions);
+			return;
 		}
-		*/
 
-		// TODO: proper checks and interface, granularity
+		// The file takes the format of the first samples played, and later samples in any other format are dropped
+		if (!wav)
+		{
+			wav.emplace(*audio_path, format);
+		}
 
-		if (!fb.set_byte(addr - fb.mmio_address, u8(data)))
+		if (wav->format() == format)
 		{
-			return AccessStatus::ErrorMmioUnmapped;
+			wav->write(samples);
 		}
-#endif
-		return AccessStatus::Ok;
 	};
+	audio.attach(bus);
+
+	std::unique_ptr<DiskImage> disk;
+
+	if (disk_path)
+	{
+		try
+		{
+			disk = std::make_unique<DiskImage>(*disk_path);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "{}\n", e.what());
+			return 1;
+		}
+	}
+
+	BlockDevice block{core, std::move(disk)};
+	block.on_interrupt = [&] { intc.raise(BlockDevice::interrupt_id); };
+	block.attach(bus);
+
+	DmaController dma{core};
+	dma.on_interrupt = [&] { intc.raise(DmaController::interrupt_id); };
+	dma.attach(bus);
+
+	Keyboard keyboard;
+	keyboard.on_interrupt = [&] { intc.raise(Keyboard::interrupt_id); };
+	keyboard.attach(bus);
+
+	std::ofstream uart_file;
+
+	if (uart_path && *uart_path != "-")
+	{
+		uart_file.open(std::string{*uart_path}, std::ios::binary);
+
+		if (!uart_file)
+		{
+			fmt::print(stderr, "Failed to open UART output '{}'\n", *uart_path);
+			return 1;
+		}
+	}
+
+	Uart uart;
+	uart.on_interrupt = [&] { intc.raise(Uart::interrupt_id); };
+	uart.on_transmit  = [&](std::string_view data) {
+		if (replaying)
+		{
+			return;
+		}
+
+		if (uart_file.is_open())
+		{
+			uart_file.write(data.data(), std::streamsize(data.size()));
+			uart_file.flush();
+		}
+		else
+		{
+			std::fwrite(data.data(), 1, data.size(), stdout);
+			std::fflush(stdout);
+		}
+	};
+	uart.attach(bus);
+
+	// Declared after the devices they feed, so that they stop first
+	std::optional<InputReader> keyboard_input;
+	std::optional<InputReader> uart_input;
+
+	try
+	{
+		if (keyboard_path)
+		{
+			keyboard_input.emplace(*keyboard_path, [&](std::span<const u8> bytes) {
+				for (const u8 byte : bytes)
+				{
+					keyboard.push(byte);
+				}
+			});
+		}
+
+		if (uart_input_path)
+		{
+			uart_input.emplace(*uart_input_path, [&](std::span<const u8> bytes) { uart.receive(bytes); });
+		}
+	}
+	catch (const std::exception& e)
+	{
+		fmt::print(stderr, "{}\n", e.what());
+		return 1;
+	}
+
+	core.sync_devices = [&] {
+		timer.sync();
+		audio.sync();
+		uart.sync();
+	};
+
+	SmpController smp;
+	smp.core_count = u32(core_count);
+	smp.on_ipi     = [&](u32 index) {
+		multicore ? multicore->interrupt(index, SmpController::ipi_interrupt)
+				  : core.raise_interrupt(SmpController::ipi_interrupt);
+	};
+	smp.attach(bus);
 
-	core.mmu.mmio_read_callback = [&](Addr addr, AccessGranularity granularity) -> std::pair<AccessStatus, u32> {
 #ifdef SMOLISA_FRAMEBUFFER
-		// TODO: proper checks and interface, granularity
-		if (const auto v = fb.get_byte(addr - fb.mmio_address); v.has_value())
+	std::optional<FrameBuffer> fb;
+
+	if (!headless)
+	{
+		fmt::print(stderr, "Preparing 80x25 standard framebuffer\n");
+		fb.emplace();
+
+		if (!keyboard_input)
 		{
-			return {AccessStatus::Ok, u32(v.value())};
+			fb->on_text_entered = [&](u8 character) { keyboard.push(character); };
 		}
+
+		// TODO: proper checks and interface, granularity
+		bus.map(
+			"framebuffer",
+			FrameBuffer::mmio_address,
+			0x1000,
+			[&](Addr offset, AccessGranularity) -> std::pair<AccessStatus, u32> {
+				if (const auto v = fb->get_byte(offset); v.has_value())
+				{
+					return {AccessStatus::Ok, u32(v.value())};
+				}
+
+				return {AccessStatus::ErrorMmioUnmapped, 0};
+			},
+			[&](Addr offset, u32 data, AccessGranularity) {
+				return fb->set_byte(offset, u8(data)) ? AccessStatus::Ok : AccessStatus::ErrorMmioUnmapped;
+			});
+	}
 #endif
 
-		return {AccessStatus::ErrorMmioUnmapped, 0};
+	bus.attach(core.mmu);
+
+	std::vector<SnapshotDevice> snapshot_devices = {
+		{"timer", [&](StateWriter& w) { timer.save_state(w); }, [&](StateReader& r) { timer.load_state(r); }},
+		{"audio", [&](StateWriter& w) { audio.save_state(w); }, [&](StateReader& r) { audio.load_state(r); }},
+		{"block", [&](StateWriter& w) { block.save_state(w); }, [&](StateReader& r) { block.load_state(r); }},
+		{"dma", [&](StateWriter& w) { dma.save_state(w); }, [&](StateReader& r) { dma.load_state(r); }},
+		{"keyboard", [&](StateWriter& w) { keyboard.save_state(w); }, [&](StateReader& r) { keyboard.load_state(r); }},
+		{"uart", [&](StateWriter& w) { uart.save_state(w); }, [&](StateReader& r) { uart.load_state(r); }},
 	};
 
+#ifdef SMOLISA_FRAMEBUFFER
+	if (fb)
+	{
+		snapshot_devices.push_back(
+			{"framebuffer", [&](StateWriter& w) { fb->save_state(w); }, [&](StateReader& r) { fb->load_state(r); }});
+	}
+#endif
+
+	if (exit_on_brk)
+	{
+		core.breakpoint_handler = [](Core& c) {
+			c.halt(c.regs[RegisterId(0)]);
+			return false;
+		};
+	}
+
+	std::optional<Semihosting> semihosting;
+
+	if (semihosting_path)
+	{
+		try
+		{
+			semihosting.emplace(*semihosting_path);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "{}\n", e.what());
+			return 1;
+		}
+
+		core.breakpoint_handler = [&](Core& c) { return semihosting->handle(c); };
+	}
+
+	std::optional<Throttle> throttle;
+
+	if (target_mhz)
+	{
+		throttle.emplace(*target_mhz);
+	}
+
+	std::optional<DirtyPages>             dirty_pages;
+	std::optional<snapshot::Checkpointer> checkpointer;
+	std::optional<RewindBuffer>           rewind;
+
 	core.keepalive = [&] {
-		if (fb.should_present())
+		const bool warping = guest_warp || core.executed_ops < warp_until;
+
+		if (throttle)
 		{
-			fb.display();
+			// Warping restarts pacing, so that leaving warp mode does not sleep off the warped instructions
+			warping ? throttle->restart(core.executed_ops) : throttle->pace(core.executed_ops);
 		}
+
+#ifdef SMOLISA_FRAMEBUFFER
+		// Window events are handled every slice rather than every frame, to keep input latency low
+		if (fb && fb->should_present() && !warping)
+		{
+			fb->display();
+
+			if (rewind && rewind_interval == 0)
+			{
+				rewind->record();
+			}
+		}
+		else if (fb)
+		{
+			fb->poll_events();
+		}
+#endif
+
+		if (checkpointer)
+		{
+			try
+			{
+				checkpointer->poll();
+			}
+			catch (const std::exception& e)
+			{
+				fmt::print(stderr, "Could not checkpoint: {}\n", e.what());
+			}
+		}
+
+		if (rewind)
+		{
+			rewind->poll();
+		}
+
+#ifdef SMOLISA_STATS
+		if (stats_dump_requested != 0)
+		{
+			stats_dump_requested = 0;
+			dump_stats(core, *stats_path);
+		}
+#endif
 	};
 
-	fb.display_simple_string(
-		fmt::format(
-			"smol2-emu [{}MiB] [{}@{:#010x}]",
-			Mmu::system_memory_size / (1024 * 1024),
-			rom_path,
-			core.rip
-		),
-		0,
-		24,
-		FrameBuffer::normal_color
-	);
+#ifdef SMOLISA_FRAMEBUFFER
+	if (fb)
+	{
+		fb->display_simple_string(
+			fmt::format(
+				"smol2-emu [{}MiB] [{}@{:#010x}]",
+				Mmu::system_memory_size / (1024 * 1024),
+				rom_path,
+				core.rip
+			),
+			0,
+			24,
+			FrameBuffer::normal_color
+		);
+	}
+#endif
+
+	std::optional<PipelinedCore> pipeline;
+	std::unique_ptr<Core>        reference;
+
+	if (use_pipeline)
+	{
+		pipeline.emplace(core, pipeline_config);
+
+		if (lockstep)
+		{
+			reference           = std::make_unique<Core>();
+			reference->mmu.ram  = core.mmu.ram;
+			reference->rip      = core.rip;
+			pipeline->enable_lockstep(*reference);
+		}
+	}
+
+	if (core_count > 1)
+	{
+		multicore.emplace(core, core_count);
+
+		// The timer counts and schedules against the instruction count of the boot core, which it cannot safely
+		// access from other threads
+		multicore->restrict_to_boot_core(IntervalTimer::mmio_address, IntervalTimer::mmio_size);
+	}
+
+	// Restored last, over the title drawn into the framebuffer
+	if (resume_snapshot)
+	{
+		try
+		{
+			snapshot::load(rom_path, core, snapshot_devices);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not resume snapshot: {}\n", e.what());
+			return 1;
+		}
+
+		// Paced from the restored instruction count rather than from 0
+		if (throttle)
+		{
+			throttle->restart(core.executed_ops);
+		}
+	}
+
+	if (checkpoint_prefix || rewind_budget)
+	{
+		dirty_pages.emplace(core.mmu.ram.size());
+		core.mmu.dirty_pages = &*dirty_pages;
+	}
+
+	if (checkpoint_prefix)
+	{
+		checkpointer.emplace(
+			core, *dirty_pages, snapshot_devices, std::string{*checkpoint_prefix}, checkpoint_interval);
+	}
+
+	if (rewind_budget)
+	{
+		rewind.emplace(core, *dirty_pages, snapshot_devices, *rewind_budget, rewind_interval);
+	}
 
 	fmt::print(stderr, "Booting CPU at {:#010x}\n", core.rip);
 
+	std::string_view stop_reason = "error";
+	int              exit_code   = 125;
+
+	const auto run_start = Core::Timer::now();
+
 	try
 	{
-		core.boot();
+		if (gdb_endpoint)
+		{
+			GdbStub stub(core);
+			stub.accept(*gdb_endpoint);
+			stub.serve();
+			stop_reason = core.halted ? "halted" : "detached";
+			exit_code   = core.halted ? int(core.exit_status & 0xFF) : 0;
+		}
+		else
+		{
+			const auto reason = pipeline  ? pipeline->boot(limits)
+							  : multicore ? multicore->run(limits).front()
+							  : headless  ? core.run(limits)
+										  : core.boot(limits);
+
+			stop_reason = stop_reason_names[std::size_t(reason)];
+			exit_code   = reason == StopReason::Halted ? int(core.exit_status & 0xFF) : 124;
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -145,14 +1075,168 @@ auto main(int argc, char** argv) -> int
 			core.debug_state_multiline()
 		);
 
-#ifdef SMOLISA_FRAMEBUFFER
-		fb.display_simple_string(error, 0, 1);
 		fmt::print(stderr, "{}", error);
+
+#ifdef SMOLISA_FRAMEBUFFER
+		if (fb)
+		{
+			fb->display_simple_string(error, 0, 1);
+		}
 #endif
 	}
 
+	const double run_seconds = std::chrono::duration<double>(Core::Timer::now() - run_start).count();
+
+	const std::uint64_t executed_ops = multicore ? multicore->executed_ops() : core.executed_ops;
+
+	if (headless)
+	{
+		fmt::print(
+			stderr,
+			"Stopped ({}) after {} instructions in {:.3f}s ({:.3f} MIPS), exit status {}\n",
+			stop_reason,
+			executed_ops,
+			run_seconds,
+			1.0e-6 * double(executed_ops) / run_seconds,
+			exit_code);
+	}
+
+	if (rewind && (rewind_to || rewind_trace))
+	{
+		uart.flush();
+		replaying = true;
+
+		// After an error, the faulting instruction did not complete and is replayed too
+		const std::uint64_t target     = rewind_to.value_or(core.executed_ops + (stop_reason == "error" ? 1 : 0));
+		const std::uint64_t trace_from = target - std::min(target, rewind_trace.value_or(0));
+
+		try
+		{
+			const auto restored = rewind->rewind_to(trace_from);
+			fmt::print(stderr, "Rewound to instruction {}, replaying up to instruction {}\n", restored, target);
+
+			rewind->replay_to(trace_from);
+			core.verbose_exec = rewind_trace.has_value();
+			rewind->replay_to(target);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Replay stopped: {}\n", e.what());
+		}
+
+		core.verbose_exec = false;
+	}
+
+	if (dump_path)
+	{
+		try
+		{
+			dump_state(core, *dump_path, stop_reason, run_seconds);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not write dump: {}\n", e.what());
+			exit_code = 125;
+		}
+	}
+
+	if (save_snapshot_path)
+	{
+		try
+		{
+			snapshot::save(*save_snapshot_path, core, snapshot_devices);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not save snapshot: {}\n", e.what());
+			exit_code = 125;
+		}
+	}
+
+	if (memory_dump)
+	{
+		std::ofstream file{std::string{memory_dump->path}, std::ios::binary};
+		file.write(
+			reinterpret_cast<const char*>(core.mmu.ram.data() + memory_dump->begin),
+			std::streamsize(memory_dump->length));
+
+		if (!file.flush())
+		{
+			fmt::print(stderr, "Could not write memory dump '{}'\n", memory_dump->path);
+			exit_code = 125;
+		}
+	}
+
+#ifdef SMOLISA_STATS
+	if (stats_path)
+	{
+		dump_stats(core, *stats_path);
+	}
+#endif
+
+	if (timing)
+	{
+		fmt::print(stderr, "{}", timing->report());
+	}
+
+	if (pipeline)
+	{
+		fmt::print(stderr, "{}", pipeline->report());
+	}
+
+	if (simulate_caches)
+	{
+		fmt::print(stderr, "{}", cache_sim.report());
+	}
+
+	if (profiler)
+	{
+		std::ofstream file{std::string{*profile_path}};
+
+		if (!(file << profiler->folded_stacks()).flush())
+		{
+			fmt::print(stderr, "Could not write profile '{}'\n", *profile_path);
+			exit_code = 125;
+		}
+
+		fmt::print(stderr, "{}", profiler->report());
+	}
+
+	if (heatmap)
+	{
+		try
+		{
+			heatmap->dump_csv(*heatmap_path);
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not write heatmap: {}\n", e.what());
+			exit_code = 125;
+		}
+	}
+
+	if (coverage)
+	{
+		try
+		{
+			coverage->save_merged(*coverage_path);
+
+			if (labels_path)
+			{
+				fmt::print(stderr, "{}", Coverage::load(*coverage_path).report(symbols));
+			}
+		}
+		catch (const std::exception& e)
+		{
+			fmt::print(stderr, "Could not save coverage: {}\n", e.what());
+			exit_code = 125;
+		}
+	}
+
 #ifdef SMOLISA_FRAMEBUFFER
-	while (fb.display())
+	while (fb && fb->display())
 	{}
 #endif
+
+	return exit_code;
 }
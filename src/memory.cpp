@@ -1,140 +1,298 @@
+#include <smol/dirtypages.hpp>
+#include <smol/heatmap.hpp>
 #include <smol/memory.hpp>
+#include <smol/watchpoints.hpp>
 
+#include <atomic>
+#include <bit>
 #include <cstddef>
 #include <fmt/core.h>
 #include <stdexcept>
 
+namespace
+{
+/// RAM accesses go through relaxed atomics so that aligned accesses are single-copy atomic, even when several cores
+/// share the same RAM. On the hosts we care about, these compile down to plain loads and stores.
+template<class T>
+auto ram_ref(const GuestRam& ram, Addr addr) -> std::atomic_ref<T>
+{
+	return std::atomic_ref<T>(*reinterpret_cast<T*>(const_cast<u8*>(ram.data()) + addr));
+}
+
+template<class T>
+constexpr auto granularity_of() -> AccessGranularity
+{
+	if constexpr (sizeof(T) == 1)
+	{
+		return AccessGranularity::U8;
+	}
+	else if constexpr (sizeof(T) == 2)
+	{
+		return AccessGranularity::U16;
+	}
+	else
+	{
+		return AccessGranularity::U32;
+	}
+}
+} // namespace
+
 Mmu::Mmu() : ram(system_memory_size) {}
 
-auto Mmu::get_u8(Addr addr) const -> std::pair<AccessStatus, u8>
+template<class T>
+auto Mmu::read(Addr addr, AccessKind kind) const -> std::pair<AccessStatus, T>
 {
 	if (!is_mapped(addr))
 	{
 		return {AccessStatus::ErrorUnmapped, 0};
 	}
 
-	if (is_mmio(addr))
+	if ((addr & (sizeof(T) - 1)) != 0)
 	{
-		// Fails if MMIO is not set up
-		const auto [err, v] = mmio_read_callback(mmio_address(addr), AccessGranularity::U8);
-		return {err, u8(v)};
+		return {AccessStatus::ErrorMisaligned, 0};
+	}
+
+	if (access_hook) [[unlikely]]
+	{
+		access_hook(addr, granularity_of<T>(), kind);
+	}
+
+	if (heatmap != nullptr) [[unlikely]]
+	{
+		heatmap->record(addr, kind);
 	}
 
-	return {AccessStatus::Ok, ram[addr]};
+	if (watchpoints != nullptr && watchpoints->is_watched_page(addr)) [[unlikely]]
+	{
+		const auto ret = load<T>(addr);
+
+		if (ret.first == AccessStatus::Ok)
+		{
+			watchpoints->check(addr, granularity_of<T>(), kind, ret.second, ret.second);
+		}
+
+		return ret;
+	}
+
+	return load<T>(addr);
 }
 
-auto Mmu::set_u8(Addr addr, u8 data) -> AccessStatus
+template<class T>
+auto Mmu::write(Addr addr, T data) -> AccessStatus
 {
 	if (!is_mapped(addr))
 	{
 		return AccessStatus::ErrorUnmapped;
 	}
 
-	if (is_mmio(addr))
+	if ((addr & (sizeof(T) - 1)) != 0)
 	{
-		// Fails if MMIO is not set up
-		return mmio_write_callback(mmio_address(addr), data, AccessGranularity::U8);
+		return AccessStatus::ErrorMisaligned;
 	}
 
-	ram[addr] = data;
-	return AccessStatus::Ok;
-}
+	if (access_hook) [[unlikely]]
+	{
+		access_hook(addr, granularity_of<T>(), AccessKind::Store);
+	}
 
-auto Mmu::get_u16(Addr addr) const -> std::pair<AccessStatus, u16>
-{
-	if (!is_mapped(addr))
+	if (heatmap != nullptr) [[unlikely]]
 	{
-		return {AccessStatus::ErrorUnmapped, 0};
+		heatmap->record(addr, AccessKind::Store);
 	}
 
-	if ((addr & 0b1) != 0)
+	if (watchpoints != nullptr && watchpoints->is_watched_page(addr)) [[unlikely]]
 	{
-		return {AccessStatus::ErrorMisaligned, 0};
+		const u32  old_value = is_mmio(addr) ? 0 : load<T>(addr).second;
+		const auto status    = store<T>(addr, data);
+
+		if (status == AccessStatus::Ok)
+		{
+			watchpoints->check(addr, granularity_of<T>(), AccessKind::Store, old_value, data);
+		}
+
+		return status;
 	}
 
+	return store<T>(addr, data);
+}
+
+template<class T>
+auto Mmu::load(Addr addr) const -> std::pair<AccessStatus, T>
+{
 	if (is_mmio(addr))
 	{
 		// Fails if MMIO is not set up
-		const auto [err, v] = mmio_read_callback(mmio_address(addr), AccessGranularity::U16);
-		return {err, u16(v)};
+		const auto [err, v] = mmio_read_callback(mmio_address(addr), granularity_of<T>());
+		return {err, T(v)};
 	}
 
-	return {
-		AccessStatus::Ok,
-		ram[addr] | (ram[addr + 1] << 8)
-	};
+	if constexpr (std::endian::native == std::endian::little)
+	{
+		return {AccessStatus::Ok, ram_ref<T>(ram, addr).load(std::memory_order_relaxed)};
+	}
+	else
+	{
+		T value = 0;
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= T(u32(ram[addr + i]) << (i * 8));
+		}
+
+		return {AccessStatus::Ok, value};
+	}
 }
 
-auto Mmu::set_u16(Addr addr, u16 data) -> AccessStatus
+template<class T>
+auto Mmu::store(Addr addr, T data) -> AccessStatus
 {
-	if (!is_mapped(addr))
+	if (is_mmio(addr))
 	{
-		return AccessStatus::ErrorUnmapped;
+		// Fails if MMIO is not set up
+		return mmio_write_callback(mmio_address(addr), data, granularity_of<T>());
 	}
 
-	if ((addr & 0b1) != 0)
+	if (dirty_pages != nullptr) [[unlikely]]
 	{
-		return AccessStatus::ErrorMisaligned;
+		dirty_pages->mark(addr);
 	}
 
-	if (is_mmio(addr))
+	if constexpr (std::endian::native == std::endian::little)
 	{
-		// Fails if MMIO is not set up
-		return mmio_write_callback(mmio_address(addr), data, AccessGranularity::U16);
+		ram_ref<T>(ram, addr).store(data, std::memory_order_relaxed);
+	}
+	else
+	{
+		for (std::size_t i = 0; i < sizeof(T); ++i)
+		{
+			ram[addr + i] = (data >> (i * 8)) & 0xFF;
+		}
 	}
 
-	ram[addr + 0] = (data >> 0) & 0xFF;
-	ram[addr + 1] = (data >> 8) & 0xFF;
 	return AccessStatus::Ok;
 }
 
+auto Mmu::get_u8(Addr addr) const -> std::pair<AccessStatus, u8>
+{
+#ifdef SMOLISA_STATS
+	++stats.loads[std::size_t(AccessGranularity::U8)][is_mmio(addr)];
+#endif
+	return read<u8>(addr, AccessKind::Load);
+}
+
+auto Mmu::set_u8(Addr addr, u8 data) -> AccessStatus
+{
+#ifdef SMOLISA_STATS
+	++stats.stores[std::size_t(AccessGranularity::U8)][is_mmio(addr)];
+#endif
+	return write<u8>(addr, data);
+}
+
+auto Mmu::get_u16(Addr addr) const -> std::pair<AccessStatus, u16>
+{
+#ifdef SMOLISA_STATS
+	++stats.loads[std::size_t(AccessGranularity::U16)][is_mmio(addr)];
+#endif
+	return read<u16>(addr, AccessKind::Load);
+}
+
+auto Mmu::set_u16(Addr addr, u16 data) -> AccessStatus
+{
+#ifdef SMOLISA_STATS
+	++stats.stores[std::size_t(AccessGranularity::U16)][is_mmio(addr)];
+#endif
+	return write<u16>(addr, data);
+}
 
 auto Mmu::get_u32(Addr addr) const -> std::pair<AccessStatus, u32>
 {
+#ifdef SMOLISA_STATS
+	++stats.loads[std::size_t(AccessGranularity::U32)][is_mmio(addr)];
+#endif
+	return read<u32>(addr, AccessKind::Load);
+}
+
+auto Mmu::set_u32(Addr addr, u32 data) -> AccessStatus
+{
+#ifdef SMOLISA_STATS
+	++stats.stores[std::size_t(AccessGranularity::U32)][is_mmio(addr)];
+#endif
+	return write<u32>(addr, data);
+}
+
+auto Mmu::compare_exchange_u32(Addr addr, u32 expected, u32 desired) -> std::pair<AccessStatus, bool>
+{
+	static_assert(std::endian::native == std::endian::little, "Atomic accesses assume a little endian host");
+
 	if (!is_mapped(addr))
 	{
-		return {AccessStatus::ErrorUnmapped, 0};
+		return {AccessStatus::ErrorUnmapped, false};
 	}
 
-	if ((addr & 0b11) != 0)
+	if ((addr & (sizeof(u32) - 1)) != 0)
 	{
-		return {AccessStatus::ErrorMisaligned, 0};
+		return {AccessStatus::ErrorMisaligned, false};
 	}
 
 	if (is_mmio(addr))
 	{
-		// Fails if MMIO is not set up
-		const auto [err, v] = mmio_read_callback(mmio_address(addr), AccessGranularity::U32);
-		return {err, v};
+		return {AccessStatus::ErrorAtomicMmio, false};
+	}
+
+#ifdef SMOLISA_STATS
+	++stats.stores[std::size_t(AccessGranularity::U32)][false];
+#endif
+
+	if (access_hook) [[unlikely]]
+	{
+		access_hook(addr, AccessGranularity::U32, AccessKind::Store);
+	}
+
+	if (heatmap != nullptr) [[unlikely]]
+	{
+		heatmap->record(addr, AccessKind::Store);
 	}
 
-	return {
-		AccessStatus::Ok,
-		ram[addr] | (ram[addr + 1] << 8) | (ram[addr + 2] << 16) | (ram[addr + 3] << 24)
-	};
+	const bool exchanged = ram_ref<u32>(ram, addr).compare_exchange_strong(expected, desired);
+
+	if (exchanged && dirty_pages != nullptr) [[unlikely]]
+	{
+		dirty_pages->mark(addr);
+	}
+
+	if (exchanged && watchpoints != nullptr && watchpoints->is_watched_page(addr)) [[unlikely]]
+	{
+		watchpoints->check(addr, AccessGranularity::U32, AccessKind::Store, expected, desired);
+	}
+
+	return {AccessStatus::Ok, exchanged};
 }
 
-auto Mmu::set_u32(Addr addr, u32 data) -> AccessStatus
+auto Mmu::fetch_u16(Addr addr) const -> std::pair<AccessStatus, u16>
+{
+	return read<u16>(addr, AccessKind::Fetch);
+}
+
+auto Mmu::prefetch_u16(Addr addr) const -> std::pair<AccessStatus, u16>
 {
 	if (!is_mapped(addr))
 	{
-		return AccessStatus::ErrorUnmapped;
+		return {AccessStatus::ErrorUnmapped, 0};
 	}
 
-	if ((addr & 0b11) != 0)
+	if ((addr & 1) != 0)
 	{
-		return AccessStatus::ErrorMisaligned;
+		return {AccessStatus::ErrorMisaligned, 0};
 	}
 
-	if (is_mmio(addr))
+	return load<u16>(addr);
+}
+
+void Mmu::record_fetch(Addr addr) const { heatmap->record(addr, AccessKind::Fetch); }
+
+void Mmu::mark_dirty(Addr addr, std::size_t length)
+{
+	if (dirty_pages != nullptr)
 	{
-		// Fails if MMIO is not set up
-		return mmio_write_callback(mmio_address(addr), data, AccessGranularity::U32);
+		dirty_pages->mark_range(addr, length);
 	}
-
-	ram[addr + 0] = (data >> 0) & 0xFF;
-	ram[addr + 1] = (data >> 8) & 0xFF;
-	ram[addr + 2] = (data >> 16) & 0xFF;
-	ram[addr + 3] = (data >> 24) & 0xFF;
-	return AccessStatus::Ok;
 }
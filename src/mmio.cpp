@@ -0,0 +1,64 @@
+#include <smol/mmio.hpp>
+
+#include <algorithm>
+#include <fmt/core.h>
+#include <stdexcept>
+
+void MmioBus::map(std::string_view name, Addr base, Addr size, ReadHandler read, WriteHandler write)
+{
+	for (const Mapping& m : m_mappings)
+	{
+		if (base < m.base + m.size && m.base < base + size)
+		{
+			throw std::runtime_error{fmt::format(
+				"MMIO mapping '{}' at {:#x} overlaps '{}' at {:#x}", name, base, m.name, m.base)};
+		}
+	}
+
+	const auto it = std::find_if(m_mappings.begin(), m_mappings.end(), [&](const Mapping& m) { return m.base > base; });
+	m_mappings.insert(it, {name, base, size, std::move(read), std::move(write)});
+}
+
+auto MmioBus::find(Addr addr) const -> const Mapping*
+{
+	for (const Mapping& m : m_mappings)
+	{
+		if (addr >= m.base && addr - m.base < m.size)
+		{
+			return &m;
+		}
+	}
+
+	return nullptr;
+}
+
+auto MmioBus::read(Addr addr, AccessGranularity granularity) const -> std::pair<AccessStatus, u32>
+{
+	const Mapping* m = find(addr);
+
+	if (m == nullptr || !m->read)
+	{
+		return {AccessStatus::ErrorMmioUnmapped, 0};
+	}
+
+	return m->read(addr - m->base, granularity);
+}
+
+auto MmioBus::write(Addr addr, u32 data, AccessGranularity granularity) const -> AccessStatus
+{
+	const Mapping* m = find(addr);
+
+	if (m == nullptr || !m->write)
+	{
+		return AccessStatus::ErrorMmioUnmapped;
+	}
+
+	return m->write(addr - m->base, data, granularity);
+}
+
+void MmioBus::attach(Mmu& mmu) const
+{
+	mmu.mmio_read_callback = [this](Addr addr, AccessGranularity granularity) { return read(addr, granularity); };
+	mmu.mmio_write_callback
+		= [this](Addr addr, u32 data, AccessGranularity granularity) { return write(addr, data, granularity); };
+}
@@ -0,0 +1,154 @@
+#include <smol/multicore.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+Multicore::Multicore(Core& boot_core, std::size_t core_count)
+{
+	if (core_count == 0)
+	{
+		throw std::runtime_error{"At least one core is required"};
+	}
+
+	cores.push_back(&boot_core);
+
+	for (std::size_t i = 1; i < core_count; ++i)
+	{
+		auto& core = *m_secondaries.emplace_back(std::make_unique<Core>());
+
+		core.mmu.ram.share(boot_core.mmu.ram);
+		core.mmu.mmio_read_callback  = boot_core.mmu.mmio_read_callback;
+		core.mmu.mmio_write_callback = boot_core.mmu.mmio_write_callback;
+
+		core.rip                 = boot_core.rip;
+		core.regs[RegisterId(0)] = Word(i);
+
+		core.panic_handler      = boot_core.panic_handler;
+		core.breakpoint_handler = boot_core.breakpoint_handler;
+
+		cores.push_back(&core);
+	}
+
+	if (core_count == 1)
+	{
+		return;
+	}
+
+	for (Core* core : cores)
+	{
+		const bool boot = core == &boot_core;
+
+		core->mmu.mmio_read_callback = [this, boot, read = std::move(core->mmu.mmio_read_callback)](
+										   Addr addr, AccessGranularity granularity) -> std::pair<AccessStatus, u32> {
+			if (!boot && is_boot_core_only(addr))
+			{
+				return {AccessStatus::ErrorMmioPeripheralError, 0};
+			}
+
+			const std::lock_guard lock{m_mmio_mutex};
+			return read(addr, granularity);
+		};
+
+		core->mmu.mmio_write_callback = [this, boot, write = std::move(core->mmu.mmio_write_callback)](
+											Addr addr, u32 data, AccessGranularity granularity) {
+			if (!boot && is_boot_core_only(addr))
+			{
+				return AccessStatus::ErrorMmioPeripheralError;
+			}
+
+			const std::lock_guard lock{m_mmio_mutex};
+			return write(addr, data, granularity);
+		};
+	}
+
+	// Devices are synced from the boot core, concurrently with MMIO accesses of the other cores
+	if (boot_core.sync_devices)
+	{
+		boot_core.sync_devices = [this, sync = std::move(boot_core.sync_devices)] {
+			const std::lock_guard lock{m_mmio_mutex};
+			sync();
+		};
+	}
+}
+
+void Multicore::restrict_to_boot_core(Addr addr, Addr size) { m_boot_core_only.push_back({.addr = addr, .size = size}); }
+
+auto Multicore::is_boot_core_only(Addr addr) const -> bool
+{
+	return std::any_of(m_boot_core_only.begin(), m_boot_core_only.end(), [&](const MmioRange& range) {
+		return addr >= range.addr && addr - range.addr < range.size;
+	});
+}
+
+void Multicore::interrupt(std::size_t index, Word interrupt_id) { cores.at(index)->raise_interrupt(interrupt_id); }
+
+void Multicore::halt(Word status)
+{
+	for (Core* core : cores)
+	{
+		core->halt(status);
+	}
+}
+
+auto Multicore::run(const RunLimits& limits) -> std::vector<StopReason>
+{
+	std::vector<StopReason>         reasons(cores.size(), StopReason::Halted);
+	std::vector<std::exception_ptr> errors(cores.size());
+
+	const auto run_core = [&](std::size_t i) {
+		try
+		{
+			reasons[i] = cores[i]->run(limits);
+
+			// Guest requests to exit, e.g. through `brk`, only halt the core that made them
+			if (reasons[i] == StopReason::Halted)
+			{
+				halt(cores[i]->exit_status);
+			}
+		}
+		catch (...)
+		{
+			errors[i] = std::current_exception();
+			halt(0);
+		}
+	};
+
+	std::vector<std::thread> threads;
+
+	for (std::size_t i = 1; i < cores.size(); ++i)
+	{
+		threads.emplace_back(run_core, i);
+	}
+
+	// The boot core stays on the calling thread, which may own e.g. the framebuffer window
+	run_core(0);
+
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	for (const auto& error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	return reasons;
+}
+
+auto Multicore::executed_ops() const -> std::uint64_t
+{
+	std::uint64_t ret = 0;
+
+	for (const Core* core : cores)
+	{
+		ret += core->executed_ops;
+	}
+
+	return ret;
+}
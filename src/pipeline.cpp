@@ -0,0 +1,470 @@
+#include <smol/pipeline.hpp>
+
+#include <algorithm>
+#include <fmt/core.h>
+#include <stdexcept>
+
+namespace
+{
+constexpr u32 t_bit_mask = 1U << 16;
+
+constexpr auto reg(RegisterId id) -> u32 { return 1U << u32(id); }
+} // namespace
+
+auto PipelinedCore::register_usage(const insns::AnyInstruction& insn) -> RegisterUsage
+{
+	using namespace insns;
+	using namespace formats;
+
+	return std::visit(
+		[](const auto& x) -> RegisterUsage {
+			using T = std::decay_t<decltype(x)>;
+
+			if constexpr (std::is_base_of_v<MemLoad, T>)
+			{
+				return {reg(x.addr), reg(x.dst)};
+			}
+			else if constexpr (std::is_same_v<T, CLR>)
+			{
+				// The destination keeps its value when `T` is clear
+				return {reg(x.src) | reg(x.dst) | t_bit_mask, reg(x.dst)};
+			}
+			else if constexpr (std::is_base_of_v<RegLoad, T>)
+			{
+				return {reg(x.src), reg(x.dst)};
+			}
+			else if constexpr (std::is_base_of_v<MemLoadWideOffset, T> || std::is_base_of_v<MemLoadShortOffset, T>)
+			{
+				return {reg(x.base_addr), reg(x.dst)};
+			}
+			else if constexpr (std::is_same_v<T, LSIH>)
+			{
+				return {reg(x.dst), reg(x.dst)};
+			}
+			else if constexpr (std::is_base_of_v<ImmByteLoad, T> || std::is_base_of_v<ImmI24Load, T>)
+			{
+				return {0, reg(x.dst)};
+			}
+			else if constexpr (std::is_same_v<T, SC32>)
+			{
+				return {reg(x.addr) | reg(x.src), t_bit_mask};
+			}
+			else if constexpr (std::is_base_of_v<MemStore, T>)
+			{
+				return {reg(x.addr) | reg(x.src), 0};
+			}
+			else if constexpr (std::is_base_of_v<MemStoreWideOffset, T> || std::is_base_of_v<MemStoreShortOffset, T>)
+			{
+				return {reg(x.base_addr) | reg(x.src), 0};
+			}
+			else if constexpr (std::is_base_of_v<StackPush, T>)
+			{
+				return {reg(x.src) | reg(RegisterId::RPS), reg(RegisterId::RPS)};
+			}
+			else if constexpr (std::is_base_of_v<TestRegReg, T>)
+			{
+				return {reg(x.a) | reg(x.b), t_bit_mask};
+			}
+			else if constexpr (std::is_base_of_v<TestRegI4, T>)
+			{
+				return {reg(x.a), t_bit_mask};
+			}
+			else if constexpr (std::is_base_of_v<PoolLoad, T>)
+			{
+				return {reg(RegisterId::RPL), reg(x.dst)};
+			}
+			else if constexpr (std::is_same_v<T, CJ>)
+			{
+				return {reg(x.target) | t_bit_mask, 0};
+			}
+			else if constexpr (std::is_base_of_v<JumpReg, T>)
+			{
+				return {reg(x.target), 0};
+			}
+			else if constexpr (std::is_base_of_v<JumpLinkReg, T>)
+			{
+				return {reg(x.target), reg(x.dst)};
+			}
+			else if constexpr (std::is_base_of_v<JumpLinkI28, T>)
+			{
+				return {0, reg(RegisterId::RRET)};
+			}
+			else if constexpr (std::is_base_of_v<JumpI12, T>)
+			{
+				return {t_bit_mask, 0};
+			}
+			else if constexpr (
+				std::is_same_v<T, BSEXT8> || std::is_same_v<T, BSEXT16> || std::is_same_v<T, BZEXT8>
+				|| std::is_same_v<T, BZEXT16> || std::is_same_v<T, INEG>)
+			{
+				return {reg(x.b), reg(x.a_dst)};
+			}
+			else if constexpr (std::is_base_of_v<ALURegReg, T>)
+			{
+				return {reg(x.a_dst) | reg(x.b), reg(x.a_dst)};
+			}
+			else if constexpr (std::is_same_v<T, IADDSITNZ> || std::is_same_v<T, BSRITLSB>)
+			{
+				return {reg(x.a_dst), reg(x.a_dst) | t_bit_mask};
+			}
+			else if constexpr (std::is_base_of_v<ALURegS4, T> || std::is_base_of_v<ALURegS5, T>)
+			{
+				return {reg(x.a_dst), reg(x.a_dst)};
+			}
+			else if constexpr (std::is_base_of_v<ALUWideAdd, T>)
+			{
+				return {reg(x.a), reg(x.dst)};
+			}
+			else
+			{
+				return {};
+			}
+		},
+		insn);
+}
+
+PipelinedCore::PipelinedCore(Core& core, PipelineConfig config) : config(config), core(core), m_fetch_rip(core.rip) {}
+
+void PipelinedCore::enable_lockstep(Core& reference)
+{
+	m_reference = &reference;
+
+	auto read  = core.mmu.mmio_read_callback;
+	auto write = core.mmu.mmio_write_callback;
+
+	core.mmu.mmio_read_callback = [this, read](Addr addr, AccessGranularity granularity) {
+		const auto result = read(addr, granularity);
+		m_mmio_log.push_back(result);
+		return result;
+	};
+
+	core.mmu.mmio_write_callback = [this, write](Addr addr, u32 data, AccessGranularity granularity) {
+		const auto status = write(addr, data, granularity);
+		m_mmio_log.emplace_back(status, 0);
+		return status;
+	};
+
+	const auto replay = [this]() -> std::pair<AccessStatus, u32> {
+		if (m_mmio_log.empty())
+		{
+			return {AccessStatus::ErrorMmioUnmapped, 0};
+		}
+
+		const auto result = m_mmio_log.front();
+		m_mmio_log.pop_front();
+		return result;
+	};
+
+	reference.mmu.mmio_read_callback = [replay](Addr, AccessGranularity) { return replay(); };
+	reference.mmu.mmio_write_callback = [replay](Addr, u32, AccessGranularity) { return replay().first; };
+}
+
+void PipelinedCore::finish_fetch(Slot& slot)
+{
+	if (!slot.fetch_fault)
+	{
+		slot.insn = insns::decode(slot.raw);
+	}
+
+	slot.usage   = register_usage(slot.insn);
+	slot.is_load = insns::classify(slot.insn) == insns::InstructionClass::Load;
+}
+
+void PipelinedCore::fetch()
+{
+	if (m_if && m_if->complete)
+	{
+		// Decode is still busy
+		return;
+	}
+
+	const auto [status, word] = core.mmu.fetch_u16(m_fetch_rip);
+
+	if (!m_if)
+	{
+		FetchSlot fetched;
+		fetched.slot.rip = m_fetch_rip;
+
+		if (status != AccessStatus::Ok)
+		{
+			// Only raised if this turns out to be on the architectural path, see `execute`
+			fetched.slot.fetch_fault = true;
+			fetched.complete         = true;
+		}
+		else
+		{
+			fetched.slot.raw    = word;
+			fetched.slot.length = insns::instruction_length(insns::decode(word));
+			fetched.complete    = fetched.slot.length == 2;
+		}
+
+		m_if = fetched;
+	}
+	else
+	{
+		++stats.extension_fetches;
+
+		if (status != AccessStatus::Ok)
+		{
+			m_if->slot.fetch_fault = true;
+		}
+
+		m_if->slot.raw |= u32(word) << 16;
+		m_if->complete = true;
+	}
+
+	m_fetch_rip += 2;
+
+	if (m_if->complete)
+	{
+		finish_fetch(m_if->slot);
+	}
+}
+
+auto PipelinedCore::hazard(const Slot& consumer) const -> std::optional<StallCause>
+{
+	const auto conflicts = [&](const std::optional<Slot>& producer) {
+		return producer && (producer->usage.writes & consumer.usage.reads) != 0;
+	};
+
+	// The instruction that was in EX during the previous cycle is now in MEM: loads only have their result now
+	if (m_mem && m_mem->is_load && conflicts(m_mem))
+	{
+		return StallCause::LoadUse;
+	}
+
+	if (!config.forwarding && (conflicts(m_mem) || conflicts(m_wb)))
+	{
+		return StallCause::DataHazard;
+	}
+
+	return std::nullopt;
+}
+
+void PipelinedCore::execute(Slot& slot)
+{
+	if (core.rip != slot.rip)
+	{
+		throw std::logic_error{fmt::format(
+			"Pipeline reached EX with {:#010x} while the architectural rip is {:#010x}", slot.rip, core.rip)};
+	}
+
+	mirror_interrupts();
+
+	if (slot.fetch_fault)
+	{
+		// Fetch again so that the core raises the exception
+		core.current_instruction.reset();
+		core.execute_single();
+	}
+	else
+	{
+		core.current_instruction = slot.raw;
+		core.execute(slot.insn);
+	}
+
+	if (m_reference != nullptr)
+	{
+		check_lockstep(slot);
+	}
+
+	if (core.rip != slot.rip + slot.length)
+	{
+		flush(core.rip);
+	}
+}
+
+void PipelinedCore::flush(Addr target)
+{
+	++stats.flushes;
+	stats.flushed_instructions += std::size_t(m_id.has_value()) + std::size_t(m_if.has_value());
+
+	m_id.reset();
+	m_if.reset();
+	m_fetch_rip = target;
+}
+
+void PipelinedCore::check_lockstep(const Slot& slot)
+{
+	Core& reference = *m_reference;
+
+	reference.current_instruction.reset();
+	reference.execute_single();
+
+	if (reference.regs.data != core.regs.data || reference.rip != core.rip || reference.t_bit != core.t_bit
+		|| reference.interrupts.enabled != core.interrupts.enabled)
+	{
+		throw std::runtime_error{fmt::format(
+			"Lockstep divergence after {} @{:#010x} (cycle {})\nPipeline:{}\nReference:{}",
+			insns::disassemble(slot.insn),
+			slot.rip,
+			stats.cycles,
+			core.debug_state_multiline(),
+			reference.debug_state_multiline())};
+	}
+}
+
+void PipelinedCore::cycle()
+{
+	++stats.cycles;
+
+	if (m_wb)
+	{
+		++stats.retired;
+	}
+
+	m_wb  = std::move(m_mem);
+	m_mem = std::move(m_ex);
+	m_ex.reset();
+
+	if (!m_id)
+	{
+		++stats.stalls[std::size_t(m_bubble_cause)];
+	}
+	else if (const auto cause = hazard(*m_id); cause.has_value())
+	{
+		++stats.stalls[std::size_t(*cause)];
+	}
+	else
+	{
+		m_ex = std::move(m_id);
+		m_id.reset();
+		execute(*m_ex);
+	}
+
+	if (!m_id && m_if && m_if->complete)
+	{
+		m_id = m_if->slot;
+		m_if.reset();
+	}
+
+	fetch();
+
+	if (!m_id)
+	{
+		m_bubble_cause = (m_if && !m_if->complete) ? StallCause::ExtensionFetch : StallCause::Control;
+	}
+
+	stats.busy[std::size_t(PipelineStage::Fetch)] += std::size_t(m_if.has_value());
+	stats.busy[std::size_t(PipelineStage::Decode)] += std::size_t(m_id.has_value());
+	stats.busy[std::size_t(PipelineStage::Execute)] += std::size_t(m_ex.has_value());
+	stats.busy[std::size_t(PipelineStage::Memory)] += std::size_t(m_mem.has_value());
+	stats.busy[std::size_t(PipelineStage::WriteBack)] += std::size_t(m_wb.has_value());
+}
+
+void PipelinedCore::deliver_interrupts()
+{
+	mirror_interrupts();
+
+	if (!core.deliver_interrupts())
+	{
+		return;
+	}
+
+	if (m_reference != nullptr)
+	{
+		m_reference->deliver_interrupts();
+	}
+
+	flush(core.rip);
+}
+
+void PipelinedCore::mirror_interrupts()
+{
+	// The reference has no devices, so it sees the interrupts raised on the pipeline
+	if (m_reference != nullptr)
+	{
+		m_reference->pending_interrupts = core.pending_interrupts.load();
+		m_reference->interrupt_mask     = core.interrupt_mask.load();
+	}
+}
+
+auto PipelinedCore::boot(const RunLimits& limits) -> StopReason
+{
+	fmt::print(stderr, "Booting pipelined core at {:#010x}\n", core.rip);
+
+	m_fetch_rip     = core.rip;
+	core.start_time = Core::Timer::now();
+
+	for (;;)
+	{
+		if (core.pending_interrupts.load(std::memory_order_relaxed) != 0)
+		{
+			deliver_interrupts();
+		}
+
+		// At most one instruction enters EX per cycle, so slices end exactly on their boundary
+		std::uint64_t slice_end = core.executed_ops + Core::slice_length - (core.executed_ops % Core::slice_length);
+
+		if (limits.max_instructions)
+		{
+			if (core.executed_ops >= *limits.max_instructions)
+			{
+				return StopReason::InstructionLimit;
+			}
+
+			slice_end = std::min<std::uint64_t>(slice_end, *limits.max_instructions);
+		}
+
+		while (core.executed_ops < std::min(slice_end, core.deadline())
+			   && !core.halted.load(std::memory_order_relaxed))
+		{
+			cycle();
+		}
+
+		if (core.halted)
+		{
+			return StopReason::Halted;
+		}
+
+		core.end_slice();
+
+		if (core.executed_ops % Core::slice_length == 0 && core.keepalive)
+		{
+			core.keepalive();
+		}
+
+		if (limits.max_time && Core::Timer::now() - core.start_time >= *limits.max_time)
+		{
+			return StopReason::TimeLimit;
+		}
+	}
+}
+
+auto PipelinedCore::report() const -> std::string
+{
+	const auto percent = [&](std::uint64_t n) {
+		return stats.cycles != 0 ? 100.0 * double(n) / double(stats.cycles) : 0.0;
+	};
+
+	std::string ret = fmt::format(
+		"Pipeline ({} forwarding{}):\n"
+		"  cycles:            {}\n"
+		"  retired:           {}\n"
+		"  IPC:               {:.3f}\n"
+		"  flushes:           {} ({} instructions squashed)\n"
+		"  extension fetches: {}\n",
+		config.forwarding ? "with" : "without",
+		m_reference != nullptr ? ", lockstep checked" : "",
+		stats.cycles,
+		stats.retired,
+		stats.cycles != 0 ? double(stats.retired) / double(stats.cycles) : 0.0,
+		stats.flushes,
+		stats.flushed_instructions,
+		stats.extension_fetches);
+
+	ret += "  stage utilization:\n";
+	for (std::size_t i = 0; i < stats.busy.size(); ++i)
+	{
+		ret += fmt::format("    {:<4} {:6.2f}%\n", pipeline_stage_names[i], percent(stats.busy[i]));
+	}
+
+	ret += "  EX bubbles:\n";
+	for (std::size_t i = 0; i < stats.stalls.size(); ++i)
+	{
+		ret += fmt::format(
+			"    {:<16} {:>14} cycles ({:.2f}%)\n", stall_cause_names[i], stats.stalls[i], percent(stats.stalls[i]));
+	}
+
+	return ret;
+}
@@ -0,0 +1,155 @@
+#include <smol/profiler.hpp>
+
+#include <algorithm>
+#include <fmt/core.h>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+Profiler::Profiler(SymbolMap symbols, ProfilerConfig config) :
+	config(config), symbols(std::move(symbols)), m_countdown(config.interval)
+{
+	if (config.interval == 0)
+	{
+		throw std::runtime_error{"Profiler sampling interval must be non-zero"};
+	}
+}
+
+void Profiler::track_call_or_return(const Core& core, const insns::AnyInstruction& insn)
+{
+	using namespace insns;
+
+	if (const auto* jal = std::get_if<JAL>(&insn); jal != nullptr)
+	{
+		if (m_stack.size() < config.max_depth)
+		{
+			m_stack.push_back({.entry = core.next_rip, .return_address = core.regs[jal->dst]});
+		}
+		return;
+	}
+
+	if (std::holds_alternative<JALI>(insn))
+	{
+		if (m_stack.size() < config.max_depth)
+		{
+			m_stack.push_back({.entry = core.next_rip, .return_address = core.regs[RegisterId::RRET]});
+		}
+		return;
+	}
+
+	// `j`/`c_j`: a jump to a pending return address unwinds up to its frame. Searching past the top frame tolerates
+	// callees that never return through the expected path, e.g. tail calls.
+	const auto it = std::find_if(
+		m_stack.rbegin(), m_stack.rend(), [&](const Frame& f) { return f.return_address == core.next_rip; });
+
+	if (it != m_stack.rend())
+	{
+		m_stack.erase(std::prev(it.base()), m_stack.end());
+	}
+}
+
+void Profiler::sample(Addr rip)
+{
+	m_countdown = config.interval;
+	++samples;
+
+	std::vector<Addr> key;
+	key.reserve(m_stack.size() + 1);
+
+	for (const Frame& frame : m_stack)
+	{
+		key.push_back(frame.entry);
+	}
+
+	key.push_back(rip);
+
+	++m_samples[std::move(key)];
+}
+
+auto Profiler::resolve_stack(const std::vector<Addr>& stack) const -> std::vector<std::string>
+{
+	std::vector<std::string> ret;
+	ret.reserve(stack.size());
+
+	for (const Addr addr : stack)
+	{
+		ret.push_back(symbols.resolve(addr));
+	}
+
+	// Sampling at a function's own label would otherwise show up as `f;f`
+	if (ret.size() >= 2 && ret[ret.size() - 1] == ret[ret.size() - 2])
+	{
+		ret.pop_back();
+	}
+
+	return ret;
+}
+
+auto Profiler::folded_stacks() const -> std::string
+{
+	// Different addresses may resolve to the same labels, so merge after resolving
+	std::map<std::string, std::uint64_t> folded;
+
+	for (const auto& [stack, count] : m_samples)
+	{
+		std::string line;
+
+		for (const auto& frame : resolve_stack(stack))
+		{
+			line += line.empty() ? frame : ";" + frame;
+		}
+
+		folded[line] += count;
+	}
+
+	std::string ret;
+
+	for (const auto& [line, count] : folded)
+	{
+		ret += fmt::format("{} {}\n", line, count);
+	}
+
+	return ret;
+}
+
+auto Profiler::report(std::size_t max_labels) const -> std::string
+{
+	struct LabelSamples
+	{
+		std::uint64_t self      = 0;
+		std::uint64_t inclusive = 0;
+	};
+
+	std::unordered_map<std::string, LabelSamples> labels;
+
+	for (const auto& [stack, count] : m_samples)
+	{
+		const auto frames = resolve_stack(stack);
+
+		labels[frames.back()].self += count;
+
+		// Recursive functions only count once per sample
+		for (const auto& frame : std::set<std::string>(frames.begin(), frames.end()))
+		{
+			labels[frame].inclusive += count;
+		}
+	}
+
+	std::vector<std::pair<std::string, LabelSamples>> sorted(labels.begin(), labels.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+		return a.second.self != b.second.self ? a.second.self > b.second.self : a.first < b.first;
+	});
+
+	std::string ret = fmt::format("Profile: {} samples, 1 every {} instructions\n", samples, config.interval);
+	ret += "     self%  inclusive%  label\n";
+
+	const auto percent = [&](std::uint64_t n) { return samples != 0 ? 100.0 * double(n) / double(samples) : 0.0; };
+
+	for (std::size_t i = 0; i < std::min(max_labels, sorted.size()); ++i)
+	{
+		const auto& [name, counts] = sorted[i];
+		ret += fmt::format("  {:>7.2f}%  {:>9.2f}%  {}\n", percent(counts.self), percent(counts.inclusive), name);
+	}
+
+	return ret;
+}
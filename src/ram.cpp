@@ -0,0 +1,120 @@
+#include <smol/ram.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+auto map_anonymous(std::size_t size) -> std::shared_ptr<u8>
+{
+	void* ret = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (ret == MAP_FAILED)
+	{
+		throw std::runtime_error{fmt::format("Failed to map guest RAM: {}", std::strerror(errno))};
+	}
+
+	return {static_cast<u8*>(ret), [size](u8* p) { munmap(p, size); }};
+}
+} // namespace
+
+RomImage::RomImage(std::string_view path) : path(path)
+{
+	m_fd = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	struct stat info{};
+	if (m_fd < 0 || fstat(m_fd, &info) != 0)
+	{
+		const int error = errno;
+
+		if (m_fd >= 0)
+		{
+			close(m_fd);
+		}
+
+		throw std::runtime_error{fmt::format("Failed to open ROM '{}': {}", path, std::strerror(error))};
+	}
+
+	size = std::size_t(info.st_size);
+}
+
+RomImage::~RomImage() { close(m_fd); }
+
+GuestRam::GuestRam(std::size_t size) : m_mapping(map_anonymous(size)), m_data(m_mapping.get()), m_size(size) {}
+
+GuestRam::GuestRam(const GuestRam& other) : GuestRam(other.m_size) { std::memcpy(m_data, other.m_data, m_size); }
+
+auto GuestRam::operator=(const GuestRam& other) -> GuestRam&
+{
+	if (this != &other)
+	{
+		if (m_size != other.m_size)
+		{
+			m_mapping = map_anonymous(other.m_size);
+			m_data    = m_mapping.get();
+			m_size    = other.m_size;
+		}
+
+		std::memcpy(m_data, other.m_data, m_size);
+	}
+
+	return *this;
+}
+
+void GuestRam::share(const GuestRam& other)
+{
+	m_mapping = other.m_mapping;
+	m_data    = other.m_data;
+	m_size    = other.m_size;
+}
+
+void GuestRam::map_rom(const RomImage& rom)
+{
+	if (rom.size > m_size)
+	{
+		throw std::runtime_error{
+			fmt::format("ROM '{}' is too large ({} bytes, RAM is {} bytes)", rom.path, rom.size, m_size)};
+	}
+
+	if (rom.size == 0)
+	{
+		return;
+	}
+
+	// The tail of the last page past the end of the file reads as zero, like the rest of RAM
+	const std::size_t length = (rom.size + page_size - 1) & ~(page_size - 1);
+
+	if (mmap(m_data, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, rom.fd(), 0) == MAP_FAILED)
+	{
+		throw std::runtime_error{fmt::format("Failed to map ROM '{}': {}", rom.path, std::strerror(errno))};
+	}
+}
+
+void GuestRam::reset()
+{
+	// Aliases from `share` keep pointing to the same, now zeroed, range
+	if (mmap(m_data, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0)
+		== MAP_FAILED)
+	{
+		throw std::runtime_error{fmt::format("Failed to reset guest RAM: {}", std::strerror(errno))};
+	}
+}
+
+void GuestRam::map_file(int fd, std::uint64_t offset, std::size_t addr, std::size_t length)
+{
+	if (addr > m_size || length > m_size - addr)
+	{
+		throw std::runtime_error{fmt::format("Mapping of {} bytes at {:#x} exceeds guest RAM", length, addr)};
+	}
+
+	if (mmap(m_data + addr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, off_t(offset)) == MAP_FAILED)
+	{
+		throw std::runtime_error{fmt::format("Failed to map file into guest RAM: {}", std::strerror(errno))};
+	}
+}
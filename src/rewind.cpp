@@ -0,0 +1,252 @@
+#include <smol/rewind.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+constexpr std::size_t page_size  = GuestRam::page_size;
+constexpr std::size_t word_count = page_size / sizeof(std::uint64_t);
+
+static_assert(DirtyPages::page_size == page_size);
+
+using PageWords = std::array<std::uint64_t, word_count>;
+
+template<class T>
+void put(std::vector<u8>& out, T value)
+{
+	const auto offset = out.size();
+	out.resize(offset + sizeof(T));
+	std::memcpy(out.data() + offset, &value, sizeof(T));
+}
+
+template<class T>
+auto get(std::span<const u8>& in) -> T
+{
+	T ret;
+	std::memcpy(&ret, in.data(), sizeof(T));
+	in = in.subspan(sizeof(T));
+	return ret;
+}
+} // namespace
+
+RewindBuffer::RewindBuffer(
+	Core& core, DirtyPages& dirty, std::vector<SnapshotDevice> devices, std::size_t budget, std::uint64_t interval) :
+	m_core(core),
+	m_dirty(dirty),
+	m_channel(dirty.open_channel()),
+	m_devices(std::move(devices)),
+	m_budget(budget),
+	m_interval(interval),
+	m_shadow(core.mmu.ram.size())
+{
+	// The shadow copy starts out as RAM, only committing the pages that are in use
+	m_dirty.collect(m_channel);
+
+	for (std::size_t offset = 0; offset < m_shadow.size(); offset += page_size)
+	{
+		PageWords words;
+		std::memcpy(words.data(), m_core.mmu.ram.data() + offset, page_size);
+
+		if (std::any_of(words.begin(), words.end(), [](std::uint64_t w) { return w != 0; }))
+		{
+			std::memcpy(m_shadow.data() + offset, words.data(), page_size);
+		}
+	}
+
+	record();
+}
+
+void RewindBuffer::poll()
+{
+	if (m_interval != 0 && m_core.executed_ops >= m_next_at)
+	{
+		record();
+	}
+}
+
+void RewindBuffer::record()
+{
+	m_next_at = m_core.executed_ops + m_interval;
+
+	// Devices may wait for pending work when saved, so their state goes first, and the pages they wrote meanwhile are
+	// part of this entry
+	Entry entry{
+		.executed_ops = m_core.executed_ops,
+		.state        = snapshot::save_state(m_core, m_devices).data,
+		.delta        = {}};
+
+	for (const u32 page : m_dirty.collect(m_channel))
+	{
+		u8* const       shadow = m_shadow.data() + std::size_t(page) * page_size;
+		const u8* const ram    = m_core.mmu.ram.data() + std::size_t(page) * page_size;
+
+		const std::size_t header = entry.delta.size();
+		put<u32>(entry.delta, page);
+		put<u32>(entry.delta, 0);
+
+		if (!encode_xor(shadow, ram, entry.delta))
+		{
+			entry.delta.resize(header);
+			continue;
+		}
+
+		const auto size = u32(entry.delta.size() - header - 2 * sizeof(u32));
+		std::memcpy(entry.delta.data() + header + sizeof(u32), &size, sizeof(size));
+		std::memcpy(shadow, ram, page_size);
+	}
+
+	entry.state.shrink_to_fit();
+	entry.delta.shrink_to_fit();
+
+	m_size += entry.size();
+	m_entries.push_back(std::move(entry));
+
+	while (m_size > m_budget && m_entries.size() > 1)
+	{
+		m_size -= m_entries.front().size();
+		m_entries.pop_front();
+
+		// The delta of the oldest entry leads from a state that is gone
+		m_size -= m_entries.front().delta.capacity();
+		m_entries.front().delta = {};
+	}
+}
+
+auto RewindBuffer::rewind_to(std::uint64_t target) -> std::uint64_t
+{
+	if (target < oldest())
+	{
+		throw std::runtime_error{
+			fmt::format("Cannot rewind to instruction {}, the oldest one kept is {}", target, oldest())};
+	}
+
+	// Pages written since the newest entry are restored from the shadow copy
+	for (const u32 page : m_dirty.collect(m_channel))
+	{
+		const std::size_t offset = std::size_t(page) * page_size;
+		std::memcpy(m_core.mmu.ram.data() + offset, m_shadow.data() + offset, page_size);
+		m_core.mmu.mark_dirty(Addr(offset), page_size);
+	}
+
+	while (newest() > target)
+	{
+		apply_delta(m_entries.back());
+		m_size -= m_entries.back().size();
+		m_entries.pop_back();
+	}
+
+	// Other consumers of the tracker see the restored pages as written, but RAM is now the shadow copy again
+	m_dirty.collect(m_channel);
+
+	snapshot::load_state(m_entries.back().state, m_core, m_devices);
+
+	m_core.halted      = false;
+	m_core.exit_status = 0;
+	m_next_at          = m_core.executed_ops + m_interval;
+
+	return newest();
+}
+
+void RewindBuffer::replay_to(std::uint64_t target)
+{
+	auto keepalive = std::exchange(m_core.keepalive, {});
+
+	try
+	{
+		m_core.run({.max_instructions = target, .max_time = std::nullopt, .report_speed = false});
+	}
+	catch (...)
+	{
+		m_core.keepalive = std::move(keepalive);
+		throw;
+	}
+
+	m_core.keepalive = std::move(keepalive);
+}
+
+auto RewindBuffer::encode_xor(const u8* a, const u8* b, std::vector<u8>& out) -> bool
+{
+	PageWords a_words;
+	PageWords b_words;
+	std::memcpy(a_words.data(), a, page_size);
+	std::memcpy(b_words.data(), b, page_size);
+
+	bool        changed = false;
+	std::size_t i       = 0;
+
+	for (;;)
+	{
+		const std::size_t skip_begin = i;
+
+		while (i < word_count && a_words[i] == b_words[i])
+		{
+			++i;
+		}
+
+		// Trailing unchanged words are left out
+		if (i == word_count)
+		{
+			return changed;
+		}
+
+		const std::size_t run_begin = i;
+
+		while (i < word_count && a_words[i] != b_words[i])
+		{
+			++i;
+		}
+
+		put<u16>(out, u16(run_begin - skip_begin));
+		put<u16>(out, u16(i - run_begin));
+
+		for (std::size_t j = run_begin; j < i; ++j)
+		{
+			put<std::uint64_t>(out, a_words[j] ^ b_words[j]);
+		}
+
+		changed = true;
+	}
+}
+
+void RewindBuffer::apply_xor(std::span<const u8> encoded, u8* page)
+{
+	PageWords words;
+	std::memcpy(words.data(), page, page_size);
+
+	std::size_t i = 0;
+
+	while (!encoded.empty())
+	{
+		i += get<u16>(encoded);
+
+		for (std::size_t count = get<u16>(encoded); count != 0; --count)
+		{
+			words[i++] ^= get<std::uint64_t>(encoded);
+		}
+	}
+
+	std::memcpy(page, words.data(), page_size);
+}
+
+void RewindBuffer::apply_delta(const Entry& entry)
+{
+	std::span<const u8> delta = entry.delta;
+
+	while (!delta.empty())
+	{
+		const auto page = get<u32>(delta);
+		const auto size = get<u32>(delta);
+
+		const std::size_t offset = std::size_t(page) * page_size;
+		apply_xor(delta.subspan(0, size), m_core.mmu.ram.data() + offset);
+		apply_xor(delta.subspan(0, size), m_shadow.data() + offset);
+		m_core.mmu.mark_dirty(Addr(offset), page_size);
+
+		delta = delta.subspan(size);
+	}
+}
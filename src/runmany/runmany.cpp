@@ -0,0 +1,327 @@
+#include <smol/core.hpp>
+#include <smol/devices/sysctl.hpp>
+#include <smol/mmio.hpp>
+#include <smol/ram.hpp>
+#include <smol/threadpool.hpp>
+#include <smol/util.hpp>
+
+#include <array>
+#include <chrono>
+#include <fmt/core.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr std::string_view usage = R"(Syntax: ./smolisa-run-many [options] [rom...]
+	Runs many independent ROM instances across all host threads, and prints per-job results as JSON
+
+	Each ROM given on the command line is a job. Jobs can also be listed in a file, one per line, as
+	`<rom> [r<n>=<value>...]` to set initial register values, e.g. for parameter sweeps. Empty lines and
+	lines starting with `#` are ignored.
+
+	Jobs exit with a status code by writing it as an u32 to 0xF0001000, or by executing `brk` with the status
+	in r0.
+
+Options:
+	--jobs <path>             Read jobs from <path>
+	--threads <n>             Number of worker threads (default: one per host thread)
+	--max-instructions <n>    Instructions executed per job before it is stopped (default 100000000)
+	--max-time <seconds>      Wall time per job before it is stopped
+	--output <path>           Write the JSON report to <path> rather than stdout
+
+	The exit code is 0 if every job halted with status 0, and 1 otherwise.
+)";
+
+using Clock = std::chrono::steady_clock;
+
+struct Job
+{
+	std::string                          rom_path;
+	std::vector<std::pair<RegisterId, Word>> registers;
+
+	/// Shared by every job running the same ROM
+	std::shared_ptr<const RomImage> rom;
+};
+
+struct JobResult
+{
+	std::string_view           stop_reason  = "error";
+	Word                       exit_status  = 0;
+	std::uint64_t              instructions = 0;
+	double                     seconds      = 0.0;
+	std::optional<std::string> error;
+};
+
+/// Parses `<rom> [r<n>=<value>...]`.
+auto parse_job(std::string_view line) -> Job
+{
+	std::istringstream stream{std::string{line}};
+
+	Job job;
+	stream >> job.rom_path;
+
+	for (std::string token; stream >> token;)
+	{
+		const auto equals = token.find('=');
+
+		if (token.size() < 2 || token[0] != 'r' || equals == std::string::npos)
+		{
+			throw std::runtime_error{fmt::format("Expected r<n>=<value>, got '{}'", token)};
+		}
+
+		const auto index = parse_unsigned(std::string_view{token}.substr(1, equals - 1));
+
+		if (index >= RegisterFile::register_count)
+		{
+			throw std::runtime_error{fmt::format("Invalid register in '{}'", token)};
+		}
+
+		job.registers.emplace_back(RegisterId(index), Word(parse_unsigned(std::string_view{token}.substr(equals + 1), 0)));
+	}
+
+	return job;
+}
+
+auto run_job(const Job& job, const RunLimits& limits) -> JobResult
+{
+	JobResult result;
+
+	const auto start = Clock::now();
+
+	try
+	{
+		Core core;
+		core.mmu.ram.map_rom(*job.rom);
+
+		for (const auto& [reg, value] : job.registers)
+		{
+			core.regs[reg] = value;
+		}
+
+		MmioBus bus;
+
+		SystemController sysctl;
+		sysctl.on_exit = [&](u32 status) { core.halt(status); };
+		sysctl.attach(bus);
+
+		bus.attach(core.mmu);
+
+		core.breakpoint_handler = [](Core& c) {
+			c.halt(c.regs[RegisterId(0)]);
+			return false;
+		};
+
+		try
+		{
+			result.stop_reason = stop_reason_names[std::size_t(core.run(limits))];
+			result.exit_status = core.exit_status;
+		}
+		catch (const std::exception& e)
+		{
+			result.error = e.what();
+		}
+
+		result.instructions = core.executed_ops;
+	}
+	catch (const std::exception& e)
+	{
+		result.error = e.what();
+	}
+
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	return result;
+}
+
+auto to_json(
+	const std::vector<Job>& jobs, const std::vector<JobResult>& results, std::size_t threads, double wall_seconds)
+	-> std::string
+{
+	std::map<std::string_view, std::size_t> per_reason;
+	std::uint64_t                           total_instructions = 0;
+
+	std::string ret = "{\n\t\"jobs\": [\n";
+
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+	{
+		const auto& job = jobs[i];
+		const auto& r   = results[i];
+
+		++per_reason[r.stop_reason];
+		total_instructions += r.instructions;
+
+		std::string registers;
+		for (const auto& [reg, value] : job.registers)
+		{
+			registers += fmt::format("{}\"{}\": {}", registers.empty() ? "" : ", ", register_name(reg), value);
+		}
+
+		ret += fmt::format(
+			"\t\t{{\"index\": {}, \"rom\": \"{}\", \"registers\": {{{}}}, \"stop_reason\": \"{}\", \"exit_status\": {}, "
+			"\"instructions\": {}, \"seconds\": {:.6f}{}}}{}\n",
+			i,
+			json_escape(job.rom_path),
+			registers,
+			r.stop_reason,
+			r.exit_status,
+			r.instructions,
+			r.seconds,
+			r.error ? fmt::format(", \"error\": \"{}\"", json_escape(*r.error)) : "",
+			i + 1 != jobs.size() ? "," : "");
+	}
+
+	ret += "\t],\n\t\"summary\": {";
+
+	for (const auto& [reason, count] : per_reason)
+	{
+		ret += fmt::format("\"{}\": {}, ", reason, count);
+	}
+
+	ret += fmt::format(
+		"\"threads\": {}, \"instructions\": {}, \"seconds\": {:.6f}, \"mips\": {:.3f}}}\n}}\n",
+		threads,
+		total_instructions,
+		wall_seconds,
+		1.0e-6 * double(total_instructions) / wall_seconds);
+
+	return ret;
+}
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+	const std::vector<std::string_view> args(argv + 1, argv + argc);
+
+	std::vector<Job>                jobs;
+	std::size_t                     threads = 0;
+	RunLimits                       limits{.max_instructions = 100'000'000, .max_time = std::nullopt};
+	std::optional<std::string_view> output_path;
+
+	try
+	{
+		for (std::size_t i = 0; i < args.size(); ++i)
+		{
+			const auto& arg = args[i];
+
+			if (arg == "-h" || arg == "--help")
+			{
+				fmt::print(stderr, "{}", usage);
+				return 1;
+			}
+
+			if (arg == "--jobs" && i + 1 < args.size())
+			{
+				std::ifstream file{std::string{args[++i]}};
+
+				if (!file)
+				{
+					throw std::runtime_error{fmt::format("Failed to open job list '{}'", args[i])};
+				}
+
+				for (std::string line; std::getline(file, line);)
+				{
+					if (line.find_first_not_of(" \t") != std::string::npos && line[0] != '#')
+					{
+						jobs.push_back(parse_job(line));
+					}
+				}
+			}
+			else if (arg == "--threads" && i + 1 < args.size())
+			{
+				threads = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--max-instructions" && i + 1 < args.size())
+			{
+				limits.max_instructions = parse_unsigned(args[++i]);
+			}
+			else if (arg == "--max-time" && i + 1 < args.size())
+			{
+				limits.max_time = std::chrono::duration<double>(parse_number(args[++i]));
+			}
+			else if (arg == "--output" && i + 1 < args.size())
+			{
+				output_path = args[++i];
+			}
+			else if (arg.starts_with("--"))
+			{
+				fmt::print(stderr, "Unexpected argument '{}'\n{}", arg, usage);
+				return 1;
+			}
+			else
+			{
+				jobs.push_back({.rom_path = std::string{arg}, .registers = {}, .rom = nullptr});
+			}
+		}
+
+		// Each ROM is opened once, and mapped by every job running it
+		std::map<std::string, std::shared_ptr<const RomImage>> roms;
+
+		for (auto& job : jobs)
+		{
+			auto& rom = roms[job.rom_path];
+
+			if (rom == nullptr)
+			{
+				rom = std::make_shared<const RomImage>(job.rom_path);
+			}
+
+			job.rom = rom;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		fmt::print(stderr, "{}\n", e.what());
+		return 1;
+	}
+
+	if (jobs.empty())
+	{
+		fmt::print(stderr, "No jobs to run\n{}", usage);
+		return 1;
+	}
+
+	std::vector<JobResult> results(jobs.size());
+
+	const auto start = Clock::now();
+
+	ThreadPool pool{threads};
+	fmt::print(stderr, "Running {} jobs on {} threads\n", jobs.size(), pool.thread_count());
+
+	for (std::size_t i = 0; i < jobs.size(); ++i)
+	{
+		pool.submit([&, i] { results[i] = run_job(jobs[i], limits); });
+	}
+
+	pool.wait();
+
+	const double wall_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	const auto json = to_json(jobs, results, pool.thread_count(), wall_seconds);
+
+	if (output_path)
+	{
+		std::ofstream{std::string{*output_path}} << json;
+	}
+	else
+	{
+		fmt::print("{}", json);
+	}
+
+	for (const auto& r : results)
+	{
+		if (r.error || r.stop_reason != stop_reason_names[std::size_t(StopReason::Halted)] || r.exit_status != 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
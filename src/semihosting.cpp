@@ -0,0 +1,268 @@
+#include <smol/semihosting.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <fmt/core.h>
+#include <linux/openat2.h>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+Semihosting::Semihosting(std::string_view sandbox)
+{
+	m_sandbox = ::open(std::string{sandbox}.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+	if (m_sandbox < 0)
+	{
+		throw std::runtime_error{
+			fmt::format("Failed to open semihosting directory '{}': {}", sandbox, std::strerror(errno))};
+	}
+}
+
+Semihosting::~Semihosting()
+{
+	for (const int fd : m_files)
+	{
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+	}
+
+	::close(m_sandbox);
+}
+
+auto Semihosting::guest_range(Core& core, Addr addr, Word length) -> std::optional<std::span<u8>>
+{
+	if (std::uint64_t(addr) + length > core.mmu.ram.size())
+	{
+		return std::nullopt;
+	}
+
+	return std::span{core.mmu.ram.data() + addr, length};
+}
+
+auto Semihosting::guest_string(Core& core, Addr addr) -> std::optional<std::string>
+{
+	const auto& ram = core.mmu.ram;
+
+	if (addr >= ram.size())
+	{
+		return std::nullopt;
+	}
+
+	const u8* const begin = ram.data() + addr;
+	const u8* const limit = begin + std::min<std::size_t>(max_path_length, ram.size() - addr);
+	const u8* const end   = std::find(begin, limit, u8(0));
+
+	if (end == limit)
+	{
+		return std::nullopt;
+	}
+
+	return std::string{begin, end};
+}
+
+auto Semihosting::file(Word handle) const -> int { return handle < m_files.size() ? m_files[handle] : -1; }
+
+auto Semihosting::open(Core& core, Addr path, Word mode) -> Word
+{
+	constexpr std::array<int, 4> mode_flags = {
+		O_RDONLY,
+		O_WRONLY | O_CREAT | O_TRUNC,
+		O_WRONLY | O_CREAT | O_APPEND,
+		O_RDWR | O_CREAT,
+	};
+
+	const auto name = guest_string(core, path);
+
+	if (!name || mode >= mode_flags.size())
+	{
+		return error;
+	}
+
+	// RESOLVE_BENEATH rejects absolute paths, and `..` or symbolic links leading out of the sandbox
+	open_how how{};
+	how.flags   = std::uint64_t(mode_flags[mode] | O_CLOEXEC);
+	how.mode    = (mode_flags[mode] & O_CREAT) != 0 ? 0644 : 0; // openat2 rejects a mode without O_CREAT
+	how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+	const int fd = int(syscall(SYS_openat2, m_sandbox, name->c_str(), &how, sizeof(how)));
+
+	if (fd < 0)
+	{
+		return error;
+	}
+
+	const auto free_slot = std::find(m_files.begin(), m_files.end(), -1);
+
+	if (free_slot != m_files.end())
+	{
+		*free_slot = fd;
+		return Word(free_slot - m_files.begin());
+	}
+
+	m_files.push_back(fd);
+	return Word(m_files.size() - 1);
+}
+
+auto Semihosting::close(Word handle) -> Word
+{
+	const int fd = file(handle);
+
+	if (fd < 0)
+	{
+		return error;
+	}
+
+	::close(fd);
+	m_files[handle] = -1;
+	return 0;
+}
+
+auto Semihosting::transfer(Core& core, Operation op, Word handle, Addr buffer, Word length) -> Word
+{
+	const int  fd    = file(handle);
+	const auto range = guest_range(core, buffer, length);
+
+	if (fd < 0 || !range)
+	{
+		return error;
+	}
+
+	if (op == Operation::Read)
+	{
+		core.mmu.mark_dirty(buffer, length);
+	}
+
+	// Loops over partial transfers, so that the guest only sees a short count at the end of the file
+	std::size_t done = 0;
+
+	while (done < range->size())
+	{
+		const ssize_t count = op == Operation::Read ? ::read(fd, range->data() + done, range->size() - done)
+													: ::write(fd, range->data() + done, range->size() - done);
+
+		if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (count < 0)
+		{
+			return done != 0 ? Word(done) : error;
+		}
+
+		if (count == 0)
+		{
+			break;
+		}
+
+		done += std::size_t(count);
+	}
+
+	return Word(done);
+}
+
+auto Semihosting::seek(Word handle, Word offset) -> Word
+{
+	const int fd = file(handle);
+
+	if (fd < 0 || lseek(fd, off_t(offset), SEEK_SET) < 0)
+	{
+		return error;
+	}
+
+	return 0;
+}
+
+auto Semihosting::handle(Core& core) -> bool
+{
+	const std::lock_guard lock{m_mutex};
+
+	auto& r = core.regs;
+
+	const Word a1 = r[RegisterId(1)];
+	const Word a2 = r[RegisterId(2)];
+	const Word a3 = r[RegisterId(3)];
+
+	Word& result = r[RegisterId(0)];
+
+	switch (Operation(result))
+	{
+	case Operation::Exit:
+	{
+		core.halt(a1);
+		break;
+	}
+	case Operation::Open:
+	{
+		result = open(core, a1, a2);
+		break;
+	}
+	case Operation::Close:
+	{
+		result = close(a1);
+		break;
+	}
+	case Operation::Read:
+	case Operation::Write:
+	{
+		result = transfer(core, Operation(result), a1, a2, a3);
+		break;
+	}
+	case Operation::Seek:
+	{
+		result = seek(a1, a2);
+		break;
+	}
+	case Operation::MemFill:
+	{
+		const auto range = guest_range(core, a1, a3);
+
+		if (range)
+		{
+			std::fill(range->begin(), range->end(), u8(a2));
+			core.mmu.mark_dirty(a1, a3);
+		}
+
+		result = range ? 0 : error;
+		break;
+	}
+	case Operation::MemCopy:
+	{
+		const auto destination = guest_range(core, a1, a3);
+		const auto source      = guest_range(core, a2, a3);
+
+		if (destination && source)
+		{
+			std::memmove(destination->data(), source->data(), a3);
+			core.mmu.mark_dirty(a1, a3);
+		}
+
+		result = destination && source ? 0 : error;
+		break;
+	}
+	case Operation::Time:
+	{
+		const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+									  std::chrono::system_clock::now().time_since_epoch())
+									  .count();
+
+		result           = Word(std::uint64_t(microseconds));
+		r[RegisterId(1)] = Word(std::uint64_t(microseconds) >> 32);
+		break;
+	}
+	default:
+	{
+		result = error;
+		break;
+	}
+	}
+
+	return false;
+}
@@ -0,0 +1,484 @@
+#include <smol/snapshot.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr std::array<char, 8> magic   = {'S', 'M', 'O', 'L', 'S', 'N', 'P', '1'};
+constexpr u32                 version = 2;
+
+/// Beyond this many runs over a chain of snapshots, RAM is read rather than mapped, to stay well within the host limit
+/// on mappings
+constexpr std::size_t max_mapped_runs = 16384;
+
+static_assert(DirtyPages::page_size == GuestRam::page_size);
+
+/// Guards against cycles in chains of incremental snapshots
+constexpr std::size_t max_chain_length = 10000;
+
+struct Header
+{
+	std::array<char, 8> magic;
+	u32                 version;
+	u32                 page_size;
+	std::uint64_t       ram_size;
+	std::uint64_t       state_offset;
+	std::uint64_t       state_size;
+	std::uint64_t       index_offset;
+	std::uint64_t       run_count;
+	std::uint64_t       data_offset;
+
+	/// Path of the snapshot that the pages of an incremental snapshot apply over, relative to the directory of this
+	/// one. Empty for full snapshots.
+	std::uint64_t parent_offset;
+	std::uint64_t parent_size;
+};
+
+/// Consecutive non-zero pages, stored back to back in the data area.
+struct PageRun
+{
+	u32 first_page;
+	u32 page_count;
+};
+
+auto is_zero_page(const u8* page) -> bool
+{
+	std::array<std::uint64_t, GuestRam::page_size / sizeof(std::uint64_t)> words;
+	std::memcpy(words.data(), page, GuestRam::page_size);
+	return std::all_of(words.begin(), words.end(), [](std::uint64_t w) { return w == 0; });
+}
+
+/// Coalesces ascending page indices into runs.
+auto runs_of(std::span<const u32> pages) -> std::vector<PageRun>
+{
+	std::vector<PageRun> ret;
+
+	for (const u32 page : pages)
+	{
+		if (!ret.empty() && ret.back().first_page + ret.back().page_count == page)
+		{
+			++ret.back().page_count;
+		}
+		else
+		{
+			ret.push_back({.first_page = page, .page_count = 1});
+		}
+	}
+
+	return ret;
+}
+
+auto find_runs(const GuestRam& ram) -> std::vector<PageRun>
+{
+	std::vector<u32>  pages;
+	const std::size_t page_count = ram.size() / GuestRam::page_size;
+
+	for (std::size_t page = 0; page < page_count; ++page)
+	{
+		if (!is_zero_page(ram.data() + page * GuestRam::page_size))
+		{
+			pages.push_back(u32(page));
+		}
+	}
+
+	return runs_of(pages);
+}
+
+auto align_to_page(std::uint64_t offset) -> std::uint64_t
+{
+	return (offset + GuestRam::page_size - 1) & ~std::uint64_t(GuestRam::page_size - 1);
+}
+
+void save_core(StateWriter& w, const Core& core)
+{
+	w.put(core.regs.data);
+	w.put(core.rip);
+	w.put(core.t_bit);
+	w.put(core.interrupts);
+	w.put(core.pending_interrupts.load());
+	w.put(core.interrupt_mask.load());
+	w.put(std::uint64_t(core.executed_ops));
+	w.put(core.reservation.has_value());
+	w.put(core.reservation.value_or(Reservation{}));
+}
+
+void load_core(StateReader& r, Core& core)
+{
+	core.regs.data          = r.get<decltype(core.regs.data)>();
+	core.rip                = r.get<u32>();
+	core.t_bit              = r.get<bool>();
+	core.interrupts         = r.get<InterruptState>();
+	core.pending_interrupts = r.get<u32>();
+	core.interrupt_mask     = r.get<u32>();
+	core.executed_ops       = r.get<std::uint64_t>();
+
+	const bool reserved    = r.get<bool>();
+	const auto reservation = r.get<Reservation>();
+	core.reservation       = reserved ? std::optional{reservation} : std::nullopt;
+}
+
+void put_section(StateWriter& state, std::string_view name, const StateWriter& section)
+{
+	state.put(u32(name.size()));
+	state.put_bytes(name.data(), name.size());
+	state.put(std::uint64_t(section.data.size()));
+	state.put_bytes(section.data.data(), section.data.size());
+}
+
+/// Reads `size` bytes at `offset`, throwing on failure or end of file.
+void read_at(int fd, void* data, std::size_t size, std::uint64_t offset)
+{
+	auto* p = static_cast<u8*>(data);
+
+	while (size != 0)
+	{
+		const ssize_t n = pread(fd, p, size, off_t(offset));
+
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (n <= 0)
+		{
+			throw std::runtime_error{
+				n == 0 ? std::string{"Truncated snapshot"}
+					   : fmt::format("Failed to read snapshot: {}", std::strerror(errno))};
+		}
+
+		p += n;
+		size -= std::size_t(n);
+		offset += std::uint64_t(n);
+	}
+}
+
+/// Closes the wrapped file descriptor on scope exit.
+struct FileDescriptor
+{
+	int fd;
+
+	~FileDescriptor()
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+	}
+};
+
+/// Writes `state` and the pages of `ram` covered by `runs`, chained to `parent` if not empty.
+void write_snapshot(
+	std::string_view            path,
+	const StateWriter&          state,
+	const GuestRam&             ram,
+	const std::vector<PageRun>& runs,
+	std::string_view            parent)
+{
+	std::string parent_link;
+
+	if (!parent.empty())
+	{
+		const auto directory = std::filesystem::absolute(std::filesystem::path{path}).parent_path();
+		parent_link          = std::filesystem::proximate(std::filesystem::absolute(parent), directory).string();
+	}
+
+	Header header{
+		.magic         = magic,
+		.version       = version,
+		.page_size     = u32(GuestRam::page_size),
+		.ram_size      = ram.size(),
+		.state_offset  = sizeof(Header),
+		.state_size    = state.data.size(),
+		.index_offset  = sizeof(Header) + state.data.size(),
+		.run_count     = runs.size(),
+		.data_offset   = 0,
+		.parent_offset = sizeof(Header) + state.data.size() + runs.size() * sizeof(PageRun),
+		.parent_size   = parent_link.size()};
+
+	header.data_offset = align_to_page(header.parent_offset + header.parent_size);
+
+	// Written aside then renamed, as RAM may still be mapped from the snapshot being replaced
+	const std::string temporary_path = fmt::format("{}.tmp", path);
+
+	{
+		std::ofstream file{temporary_path, std::ios::binary | std::ios::trunc};
+
+		if (!file)
+		{
+			throw std::runtime_error{fmt::format("Failed to create snapshot '{}'", temporary_path)};
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(state.data.data()), std::streamsize(state.data.size()));
+		file.write(reinterpret_cast<const char*>(runs.data()), std::streamsize(runs.size() * sizeof(PageRun)));
+		file.write(parent_link.data(), std::streamsize(parent_link.size()));
+		file.seekp(std::streamoff(header.data_offset));
+
+		for (const auto& run : runs)
+		{
+			file.write(
+				reinterpret_cast<const char*>(ram.data() + std::size_t(run.first_page) * GuestRam::page_size),
+				std::streamsize(std::size_t(run.page_count) * GuestRam::page_size));
+		}
+
+		if (!file.flush())
+		{
+			throw std::runtime_error{fmt::format("Failed to write snapshot '{}'", temporary_path)};
+		}
+	}
+
+	if (std::rename(temporary_path.c_str(), std::string{path}.c_str()) != 0)
+	{
+		throw std::runtime_error{fmt::format("Failed to write snapshot '{}': {}", path, std::strerror(errno))};
+	}
+}
+
+/// Restores the RAM of the snapshot at `path` and of its parents, returning its state sections.
+auto load_ram(const std::filesystem::path& path, GuestRam& ram, std::size_t depth, std::size_t& mapped_runs)
+	-> std::vector<u8>
+{
+	if (depth > max_chain_length)
+	{
+		throw std::runtime_error{fmt::format("Snapshot chain through '{}' is too long", path.string())};
+	}
+
+	const FileDescriptor file{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+
+	if (file.fd < 0)
+	{
+		throw std::runtime_error{fmt::format("Failed to open snapshot '{}': {}", path.string(), std::strerror(errno))};
+	}
+
+	Header header{};
+	read_at(file.fd, &header, sizeof(header), 0);
+
+	if (header.magic != magic || header.version != version)
+	{
+		throw std::runtime_error{fmt::format("'{}' is not a snapshot of a supported version", path.string())};
+	}
+
+	if (header.page_size != GuestRam::page_size || header.ram_size != ram.size())
+	{
+		throw std::runtime_error{fmt::format(
+			"Snapshot '{}' was taken with {} bytes of RAM in {} byte pages, this machine has {} bytes in {} byte pages",
+			path.string(),
+			header.ram_size,
+			header.page_size,
+			ram.size(),
+			GuestRam::page_size)};
+	}
+
+	std::vector<u8> state(header.state_size);
+	read_at(file.fd, state.data(), state.size(), header.state_offset);
+
+	std::vector<PageRun> runs(header.run_count);
+	read_at(file.fd, runs.data(), runs.size() * sizeof(PageRun), header.index_offset);
+
+	std::string parent(header.parent_size, '\0');
+	read_at(file.fd, parent.data(), parent.size(), header.parent_offset);
+
+	// Mapping pages past the end of the file would only fault once touched. Without pages, the file ends before the
+	// data area.
+	std::uint64_t page_count = 0;
+
+	for (const auto& run : runs)
+	{
+		page_count += run.page_count;
+	}
+
+	struct stat info{};
+	if (fstat(file.fd, &info) != 0
+		|| (page_count != 0 && std::uint64_t(info.st_size) < header.data_offset + page_count * GuestRam::page_size))
+	{
+		throw std::runtime_error{fmt::format("Truncated snapshot '{}'", path.string())};
+	}
+
+	if (parent.empty())
+	{
+		ram.reset();
+	}
+	else
+	{
+		load_ram(path.parent_path() / parent, ram, depth + 1, mapped_runs);
+	}
+
+	mapped_runs += runs.size();
+
+	std::uint64_t offset = header.data_offset;
+
+	for (const auto& run : runs)
+	{
+		const std::size_t addr   = std::size_t(run.first_page) * GuestRam::page_size;
+		const std::size_t length = std::size_t(run.page_count) * GuestRam::page_size;
+
+		if (addr > ram.size() || length > ram.size() - addr)
+		{
+			throw std::runtime_error{fmt::format("Snapshot '{}' has pages beyond the end of RAM", path.string())};
+		}
+
+		// Mapped pages are only read from the file once touched, and copied once written to
+		mapped_runs <= max_mapped_runs ? ram.map_file(file.fd, offset, addr, length)
+									   : read_at(file.fd, ram.data() + addr, length, offset);
+
+		offset += length;
+	}
+
+	return state;
+}
+} // namespace
+
+namespace snapshot
+{
+auto save_state(const Core& core, const std::vector<SnapshotDevice>& devices) -> StateWriter
+{
+	// Devices are saved first, as saving may wait for them to complete pending work and raise interrupts. The core
+	// still comes first in the file, as restoring devices can depend on its state.
+	std::vector<StateWriter> device_sections(devices.size());
+
+	for (std::size_t i = 0; i < devices.size(); ++i)
+	{
+		devices[i].save(device_sections[i]);
+	}
+
+	StateWriter core_section;
+	save_core(core_section, core);
+
+	StateWriter state;
+	put_section(state, "core", core_section);
+
+	for (std::size_t i = 0; i < devices.size(); ++i)
+	{
+		put_section(state, devices[i].name, device_sections[i]);
+	}
+
+	return state;
+}
+
+void load_state(std::span<const u8> state, Core& core, const std::vector<SnapshotDevice>& devices)
+{
+	StateReader sections{state};
+
+	while (!sections.data.empty())
+	{
+		std::string name(sections.get<u32>(), '\0');
+		sections.get_bytes(name.data(), name.size());
+
+		const auto size = sections.get<std::uint64_t>();
+
+		if (size > sections.data.size())
+		{
+			throw std::runtime_error{"Truncated snapshot state"};
+		}
+
+		StateReader section{sections.data.subspan(0, size)};
+		sections.data = sections.data.subspan(size);
+
+		if (name == "core")
+		{
+			load_core(section, core);
+		}
+		else if (const auto it = std::find_if(
+					 devices.begin(), devices.end(), [&](const SnapshotDevice& d) { return d.name == name; });
+				 it != devices.end())
+		{
+			it->load(section);
+		}
+	}
+}
+
+auto is_snapshot(std::string_view path) -> bool
+{
+	std::ifstream       file{std::string{path}, std::ios::binary};
+	std::array<char, 8> head{};
+	return file.read(head.data(), head.size()) && head == magic;
+}
+
+void save(std::string_view path, const Core& core, const std::vector<SnapshotDevice>& devices)
+{
+	const auto state = save_state(core, devices);
+	write_snapshot(path, state, core.mmu.ram, find_runs(core.mmu.ram), {});
+}
+
+void save_incremental(
+	std::string_view                   path,
+	const Core&                        core,
+	const std::vector<SnapshotDevice>& devices,
+	std::string_view                   parent,
+	std::span<const u32>               pages)
+{
+	const auto state = save_state(core, devices);
+	write_snapshot(path, state, core.mmu.ram, runs_of(pages), parent);
+}
+
+void load(std::string_view path, Core& core, const std::vector<SnapshotDevice>& devices)
+{
+	std::size_t mapped_runs = 0;
+	const auto  state       = load_ram(std::filesystem::path{path}, core.mmu.ram, 0, mapped_runs);
+
+	// Every page may differ from what the tracker last saw
+	if (core.mmu.dirty_pages != nullptr)
+	{
+		core.mmu.dirty_pages->mark_all();
+	}
+
+	load_state(state, core, devices);
+}
+
+Checkpointer::Checkpointer(
+	Core& core, DirtyPages& dirty, std::vector<SnapshotDevice> devices, std::string prefix, std::uint64_t interval) :
+	m_core(core),
+	m_dirty(dirty),
+	m_channel(dirty.open_channel()),
+	m_devices(std::move(devices)),
+	m_prefix(std::move(prefix)),
+	m_interval(std::max<std::uint64_t>(interval, 1)),
+	m_next_at(core.executed_ops + m_interval)
+{}
+
+void Checkpointer::poll()
+{
+	if (m_core.executed_ops >= m_next_at)
+	{
+		checkpoint();
+	}
+}
+
+auto Checkpointer::checkpoint() -> std::string
+{
+	m_next_at = m_core.executed_ops + m_interval;
+
+	std::string path = fmt::format("{}.{}.snap", m_prefix, m_count);
+
+	// Devices may wait for pending work when saved, so their state goes first, and the pages they wrote meanwhile are
+	// part of this checkpoint
+	const auto state = save_state(m_core, m_devices);
+	const auto pages = m_dirty.collect(m_channel);
+
+	try
+	{
+		m_previous.empty() ? write_snapshot(path, state, m_core.mmu.ram, find_runs(m_core.mmu.ram), {})
+						   : write_snapshot(path, state, m_core.mmu.ram, runs_of(pages), m_previous);
+	}
+	catch (...)
+	{
+		// The collected pages are lost, so the next checkpoint starts a new chain
+		m_previous.clear();
+		throw;
+	}
+
+	++m_count;
+	m_previous = path;
+	return path;
+}
+} // namespace snapshot
@@ -0,0 +1,75 @@
+#include <smol/stats.hpp>
+
+#include <smol/core.hpp>
+
+#include <fmt/core.h>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+auto access_counters_json(const MemoryStats::Counters& counters) -> std::string
+{
+	constexpr std::array<std::string_view, 2>                                          targets = {"ram", "mmio"};
+	constexpr std::array<std::string_view, std::size_t(AccessGranularity::Count)> widths  = {"u8", "u16", "u32"};
+
+	std::string ret = "{";
+
+	for (std::size_t target = 0; target < targets.size(); ++target)
+	{
+		ret += fmt::format("{}\"{}\": {{", target != 0 ? ", " : "", targets[target]);
+
+		for (std::size_t width = 0; width < widths.size(); ++width)
+		{
+			ret += fmt::format("{}\"{}\": {}", width != 0 ? ", " : "", widths[width], counters[width][target]);
+		}
+
+		ret += "}";
+	}
+
+	return ret + "}";
+}
+
+auto branch_json(const BranchStats& branch) -> std::string
+{
+	return fmt::format("{{\"taken\": {}, \"not_taken\": {}}}", branch.taken, branch.not_taken);
+}
+} // namespace
+
+auto stats_to_json(const Core& core) -> std::string
+{
+	std::string ret = "{\n";
+
+	ret += fmt::format("\t\"executed_ops\": {},\n", core.executed_ops);
+
+	ret += "\t\"opcodes\": {\n";
+	for (std::size_t i = 0; i < insns::mnemonics.size(); ++i)
+	{
+		ret += fmt::format(
+			"\t\t\"{}\": {}{}\n",
+			insns::mnemonics[i],
+			core.stats.op_counts[i],
+			i + 1 != insns::mnemonics.size() ? "," : "");
+	}
+	ret += "\t},\n";
+
+	ret += fmt::format(
+		"\t\"branches\": {{\"c_j\": {}, \"c_ji\": {}}},\n", branch_json(core.stats.cj), branch_json(core.stats.cji));
+	ret += fmt::format("\t\"loads\": {},\n", access_counters_json(core.mmu.stats.loads));
+	ret += fmt::format("\t\"stores\": {},\n", access_counters_json(core.mmu.stats.stores));
+	ret += fmt::format("\t\"exceptions\": {}\n", core.stats.exceptions);
+
+	return ret + "}\n";
+}
+
+void dump_stats(const Core& core, std::string_view path)
+{
+	std::ofstream file{std::string{path}};
+
+	if (!file)
+	{
+		throw std::runtime_error{fmt::format("Failed to open stats file '{}'", path)};
+	}
+
+	file << stats_to_json(core);
+}
@@ -0,0 +1,50 @@
+#include <smol/symbols.hpp>
+
+#include <algorithm>
+#include <fmt/core.h>
+#include <fstream>
+#include <stdexcept>
+
+auto SymbolMap::load(std::string_view path) -> SymbolMap
+{
+	std::ifstream file{std::string{path}};
+
+	if (!file)
+	{
+		throw std::runtime_error{fmt::format("Failed to open label map '{}'", path)};
+	}
+
+	SymbolMap   ret;
+	std::string address;
+	std::string name;
+
+	while (file >> address >> name)
+	{
+		try
+		{
+			ret.symbols.emplace_back(Addr(std::stoul(address, nullptr, 0)), name);
+		}
+		catch (const std::exception&)
+		{
+			throw std::runtime_error{fmt::format("Malformed address '{}' in label map '{}'", address, path)};
+		}
+	}
+
+	std::stable_sort(
+		ret.symbols.begin(), ret.symbols.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	return ret;
+}
+
+auto SymbolMap::resolve(Addr addr) const -> std::string
+{
+	const auto it = std::upper_bound(
+		symbols.begin(), symbols.end(), addr, [](Addr a, const auto& symbol) { return a < symbol.first; });
+
+	if (it == symbols.begin())
+	{
+		return fmt::format("{:#010x}", addr);
+	}
+
+	return std::prev(it)->second;
+}
@@ -0,0 +1,127 @@
+#include <smol/threadpool.hpp>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(std::size_t thread_count)
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max(1U, std::thread::hardware_concurrency());
+	}
+
+	for (std::size_t i = 0; i < thread_count; ++i)
+	{
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+
+	for (std::size_t i = 0; i < thread_count; ++i)
+	{
+		m_threads.emplace_back([this, i] { work(i); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	wait();
+
+	{
+		const std::lock_guard lock{m_mutex};
+		m_stopping = true;
+	}
+
+	m_work_available.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+void ThreadPool::submit(Task task)
+{
+	Worker& worker = *m_workers[m_next_worker];
+	m_next_worker  = (m_next_worker + 1) % m_workers.size();
+
+	// Counted before being published, as another worker may take and complete it right away
+	{
+		const std::lock_guard lock{m_mutex};
+		++m_queued;
+		++m_pending;
+	}
+
+	{
+		const std::lock_guard lock{worker.mutex};
+		worker.tasks.push_back(std::move(task));
+	}
+
+	m_work_available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock lock{m_mutex};
+	m_idle.wait(lock, [&] { return m_pending == 0; });
+}
+
+auto ThreadPool::take(std::size_t index) -> std::optional<Task>
+{
+	std::optional<Task> ret;
+
+	{
+		Worker&               own = *m_workers[index];
+		const std::lock_guard lock{own.mutex};
+
+		if (!own.tasks.empty())
+		{
+			ret = std::move(own.tasks.back());
+			own.tasks.pop_back();
+		}
+	}
+
+	for (std::size_t i = 1; !ret && i < m_workers.size(); ++i)
+	{
+		Worker&               victim = *m_workers[(index + i) % m_workers.size()];
+		const std::lock_guard lock{victim.mutex};
+
+		if (!victim.tasks.empty())
+		{
+			ret = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+		}
+	}
+
+	if (ret)
+	{
+		const std::lock_guard lock{m_mutex};
+		--m_queued;
+	}
+
+	return ret;
+}
+
+void ThreadPool::work(std::size_t index)
+{
+	for (;;)
+	{
+		if (auto task = take(index))
+		{
+			(*task)();
+
+			const std::lock_guard lock{m_mutex};
+			if (--m_pending == 0)
+			{
+				m_idle.notify_all();
+			}
+
+			continue;
+		}
+
+		std::unique_lock lock{m_mutex};
+		m_work_available.wait(lock, [&] { return m_queued != 0 || m_stopping; });
+
+		if (m_stopping && m_queued == 0)
+		{
+			return;
+		}
+	}
+}
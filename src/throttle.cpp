@@ -0,0 +1,52 @@
+#include <smol/throttle.hpp>
+
+#include <cerrno>
+#include <ctime>
+#include <stdexcept>
+#include <sys/prctl.h>
+
+Throttle::Throttle(double target_mhz) : m_target_mhz(target_mhz)
+{
+	if (!(target_mhz > 0.0))
+	{
+		throw std::runtime_error{"Target speed must be positive"};
+	}
+
+	// The default 50us slack lets the kernel coalesce wakeups at the expense of precision
+	prctl(PR_SET_TIMERSLACK, 1UL);
+}
+
+void Throttle::pace(std::uint64_t executed_ops)
+{
+	const auto due = m_start
+		+ std::chrono::duration_cast<Clock::duration>(
+						 std::chrono::duration<double, std::micro>(double(executed_ops - m_start_ops) / m_target_mhz));
+
+	const auto now = Clock::now();
+
+	if (now - due > max_lag)
+	{
+		restart(executed_ops);
+		return;
+	}
+
+	if (due - now > spin_duration)
+	{
+		// Sleeps to an absolute time, so that being preempted before the call does not oversleep
+		const auto     wake = (due - spin_duration).time_since_epoch();
+		const auto     secs = std::chrono::duration_cast<std::chrono::seconds>(wake);
+		const timespec ts{.tv_sec = secs.count(), .tv_nsec = std::chrono::nanoseconds(wake - secs).count()};
+
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+		{}
+	}
+
+	while (Clock::now() < due)
+	{}
+}
+
+void Throttle::restart(std::uint64_t executed_ops)
+{
+	m_start     = Clock::now();
+	m_start_ops = executed_ops;
+}
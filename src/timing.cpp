@@ -0,0 +1,184 @@
+#include <smol/timing.hpp>
+
+#include <fmt/core.h>
+#include <stdexcept>
+#include <string>
+
+auto parse_timing_config(std::string_view spec) -> TimingConfig
+{
+	TimingConfig config;
+
+	const auto separator = spec.find(':');
+	const auto name      = spec.substr(0, separator);
+
+	if (name == "not-taken")
+	{
+		config.predictor = BranchPredictor::NotTaken;
+	}
+	else if (name == "taken")
+	{
+		config.predictor = BranchPredictor::Taken;
+	}
+	else if (name == "btfn")
+	{
+		config.predictor = BranchPredictor::BackwardTaken;
+	}
+	else if (name == "bimodal")
+	{
+		config.predictor = BranchPredictor::Bimodal;
+
+		if (separator != std::string_view::npos)
+		{
+			config.bimodal_entries = std::stoul(std::string{spec.substr(separator + 1)});
+		}
+
+		if (config.bimodal_entries == 0 || (config.bimodal_entries & (config.bimodal_entries - 1)) != 0)
+		{
+			throw std::runtime_error{"Bimodal predictor size must be a power of two"};
+		}
+	}
+	else
+	{
+		throw std::runtime_error{fmt::format("Unknown branch predictor '{}'", spec)};
+	}
+
+	return config;
+}
+
+// Counters start as weakly not taken
+TimingModel::TimingModel(TimingConfig config) : config(config), m_counters(config.bimodal_entries, 1) {}
+
+auto TimingModel::predict(const insns::AnyInstruction& insn, Addr rip, bool taken) -> bool
+{
+	switch (config.predictor)
+	{
+	case BranchPredictor::NotTaken: return false;
+	case BranchPredictor::Taken: return true;
+
+	case BranchPredictor::BackwardTaken:
+	{
+		const auto* cji = std::get_if<insns::CJI>(&insn);
+		return cji != nullptr && cji->relative_target < 0;
+	}
+
+	case BranchPredictor::Bimodal:
+	default:
+	{
+		auto&      counter   = m_counters[(rip >> 1) & (m_counters.size() - 1)];
+		const bool predicted = counter >= 2;
+
+		if (taken && counter < 3)
+		{
+			++counter;
+		}
+		else if (!taken && counter > 0)
+		{
+			--counter;
+		}
+
+		return predicted;
+	}
+	}
+}
+
+void TimingModel::account(const insns::AnyInstruction& insn, Addr rip, Addr next_rip)
+{
+	const auto insn_class  = insns::classify(insn);
+	const auto length      = insns::instruction_length(insn);
+	const bool fallthrough = next_rip == rip + length;
+
+	std::uint64_t insn_cycles = 1;
+
+	const std::uint64_t extension_stall = ((length - 2) / 2) * config.extension_word_penalty;
+	insn_cycles += extension_stall;
+	stalls.extension_words += extension_stall;
+
+	switch (insn_class)
+	{
+	case insns::InstructionClass::Branch:
+	{
+		++branches;
+
+		if (predict(insn, rip, !fallthrough) == fallthrough)
+		{
+			++mispredicted_branches;
+			insn_cycles += config.mispredict_penalty;
+			stalls.mispredicts += config.mispredict_penalty;
+		}
+
+		break;
+	}
+
+	case insns::InstructionClass::Jump:
+	{
+		// `jali` targets are immediate and resolved at decode
+		if (!std::holds_alternative<insns::JALI>(insn))
+		{
+			insn_cycles += config.redirect_penalty;
+			stalls.redirects += config.redirect_penalty;
+		}
+
+		break;
+	}
+
+	default:
+	{
+		// Exceptions and `intret`
+		if (!fallthrough)
+		{
+			insn_cycles += config.redirect_penalty;
+			stalls.redirects += config.redirect_penalty;
+		}
+
+		break;
+	}
+	}
+
+	++instructions;
+	cycles += insn_cycles;
+
+	auto& class_timing = per_class[std::size_t(insn_class)];
+	++class_timing.instructions;
+	class_timing.cycles += insn_cycles;
+}
+
+auto TimingModel::ipc() const -> double { return cycles != 0 ? double(instructions) / double(cycles) : 0.0; }
+
+auto TimingModel::report() const -> std::string
+{
+	constexpr std::array<std::string_view, 4> predictor_names = {"not-taken", "taken", "btfn", "bimodal"};
+
+	std::string ret = fmt::format(
+		"Timing estimate ({} predictor):\n"
+		"  instructions: {}\n"
+		"  cycles:       {}\n"
+		"  IPC:          {:.3f}\n",
+		predictor_names.at(std::size_t(config.predictor)),
+		instructions,
+		cycles,
+		ipc());
+
+	ret += "  stall cycles:\n";
+	ret += fmt::format("    extension words:    {}\n", stalls.extension_words);
+	ret += fmt::format(
+		"    branch mispredicts: {} ({}/{} branches, {:.2f}% accuracy)\n",
+		stalls.mispredicts,
+		mispredicted_branches,
+		branches,
+		branches != 0 ? 100.0 * double(branches - mispredicted_branches) / double(branches) : 100.0);
+	ret += fmt::format("    redirects:          {}\n", stalls.redirects);
+
+	ret += "  per class:\n";
+	for (std::size_t i = 0; i < per_class.size(); ++i)
+	{
+		const auto& [class_instructions, class_cycles] = per_class[i];
+		ret += fmt::format(
+			"    {:<7} {:>14} ins {:>14} cycles ({:.1f}%)\n",
+			insns::instruction_class_names[i],
+			class_instructions,
+			class_cycles,
+			cycles != 0 ? 100.0 * double(class_cycles) / double(cycles) : 0.0);
+	}
+
+	return ret;
+}
@@ -0,0 +1,62 @@
+#include <smol/util.hpp>
+
+#include <smol/types.hpp>
+
+#include <cmath>
+#include <fmt/core.h>
+#include <stdexcept>
+
+auto parse_unsigned(std::string_view value, int base) -> std::uint64_t
+{
+	if (value.empty() || value[0] < '0' || value[0] > '9')
+	{
+		throw std::invalid_argument{fmt::format("'{}' is not an unsigned integer", value)};
+	}
+
+	std::size_t end = 0;
+	const auto  ret = std::stoull(std::string{value}, &end, base);
+
+	if (end != value.size())
+	{
+		throw std::invalid_argument{fmt::format("'{}' is not an unsigned integer", value)};
+	}
+
+	return ret;
+}
+
+auto parse_number(std::string_view value) -> double
+{
+	std::size_t end = 0;
+	const auto  ret = value.empty() ? -1.0 : std::stod(std::string{value}, &end);
+
+	if (end != value.size() || !std::isfinite(ret) || ret < 0.0)
+	{
+		throw std::invalid_argument{fmt::format("'{}' is not a non-negative number", value)};
+	}
+
+	return ret;
+}
+
+auto json_escape(std::string_view s) -> std::string
+{
+	std::string ret;
+
+	for (const char c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			ret += '\\';
+			ret += c;
+		}
+		else if (u8(c) < 0x20)
+		{
+			ret += fmt::format("\\u{:04x}", int(c));
+		}
+		else
+		{
+			ret += c;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,61 @@
+#include <smol/watchpoints.hpp>
+
+#include <algorithm>
+
+WatchpointSet::WatchpointSet() : m_watched_pages(Mmu::address_space_size >> page_shift) {}
+
+void WatchpointSet::add(Watchpoint watchpoint)
+{
+	m_watchpoints.push_back(watchpoint);
+	update_pages();
+}
+
+auto WatchpointSet::remove(const Watchpoint& watchpoint) -> bool
+{
+	const auto removed = std::erase_if(m_watchpoints, [&](const Watchpoint& w) {
+		return w.addr == watchpoint.addr && w.length == watchpoint.length && w.kind == watchpoint.kind;
+	});
+
+	update_pages();
+	return removed != 0;
+}
+
+void WatchpointSet::check(Addr addr, AccessGranularity granularity, AccessKind kind, u32 old_value, u32 new_value)
+	const
+{
+	if (kind == AccessKind::Fetch)
+	{
+		return;
+	}
+
+	const std::uint64_t begin = addr;
+	const std::uint64_t end   = begin + (std::uint64_t(1) << std::size_t(granularity));
+
+	for (const Watchpoint& w : m_watchpoints)
+	{
+		const bool overlaps = begin < w.addr + std::uint64_t(w.length) && w.addr < end;
+		const bool matches
+			= w.kind == WatchpointKind::Access || (w.kind == WatchpointKind::Write) == (kind == AccessKind::Store);
+
+		if (overlaps && matches && on_hit)
+		{
+			on_hit({w, addr, granularity, kind, old_value, new_value});
+		}
+	}
+}
+
+void WatchpointSet::update_pages()
+{
+	std::fill(m_watched_pages.begin(), m_watched_pages.end(), 0);
+
+	for (const Watchpoint& w : m_watchpoints)
+	{
+		const std::uint64_t last = std::min<std::uint64_t>(
+			std::uint64_t(w.addr) + std::max<std::size_t>(w.length, 1) - 1, Mmu::address_space_size - 1);
+
+		for (std::uint64_t page = w.addr >> page_shift; page <= (last >> page_shift); ++page)
+		{
+			m_watched_pages[page] = 1;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#include <smol/wav.hpp>
+
+#include <array>
+#include <fmt/core.h>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+template<class T>
+void put_le(std::ofstream& file, T value)
+{
+	std::array<char, sizeof(T)> bytes{};
+
+	for (std::size_t i = 0; i < sizeof(T); ++i)
+	{
+		bytes[i] = char((value >> (i * 8)) & 0xFF);
+	}
+
+	file.write(bytes.data(), bytes.size());
+}
+} // namespace
+
+WavWriter::WavWriter(std::string_view path, AudioFormat format) :
+	m_file(std::string{path}, std::ios::binary), m_format(format)
+{
+	if (!m_file)
+	{
+		throw std::runtime_error{fmt::format("Failed to open WAV file '{}'", path)};
+	}
+
+	write_header();
+}
+
+WavWriter::~WavWriter()
+{
+	m_file.seekp(0);
+	write_header();
+}
+
+void WavWriter::write(std::span<const u8> samples)
+{
+	m_file.write(reinterpret_cast<const char*>(samples.data()), std::streamsize(samples.size()));
+	m_data_size += samples.size();
+}
+
+void WavWriter::write_header()
+{
+	const auto frame_size = u16(m_format.bytes_per_frame());
+
+	m_file.write("RIFF", 4);
+	put_le(m_file, u32(36 + m_data_size));
+	m_file.write("WAVEfmt ", 8);
+	put_le(m_file, u32(16));
+	put_le(m_file, u16(1)); // PCM
+	put_le(m_file, m_format.channels);
+	put_le(m_file, m_format.sample_rate);
+	put_le(m_file, u32(m_format.sample_rate * frame_size));
+	put_le(m_file, frame_size);
+	put_le(m_file, m_format.bits_per_sample);
+	m_file.write("data", 4);
+	put_le(m_file, u32(m_data_size));
+}